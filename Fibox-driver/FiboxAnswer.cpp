@@ -1,10 +1,10 @@
 #include "FiboxAnswer.h"
 
-FiboxAnswer::FiboxAnswer(double temperature, double pressure, double phase, std::map<UInt, String> errors)
+FiboxAnswer::FiboxAnswer(double temperature, double pressure, double phase, FiboxStatus status)
 {
 	this->temperature = temperature;
 	this->pressure = pressure;
 	this->phase = phase;
-	this->errors = errors;
+	this->status = status;
 	this->isTemperatureEnabled = false;
 }
@@ -1,7 +1,7 @@
 #pragma once
 
 #include "../types.h"
-#include <map>
+#include "FiboxStatus.h"
 
 /**
 * FiboxAnswer - Fibox driver answer class
@@ -13,9 +13,9 @@ public:
     double temperature;
     double pressure;
     double phase;
-    std::map<UInt, String> errors;
+    FiboxStatus status;
     bool isTemperatureEnabled;
 
-    FiboxAnswer(double temperature, double pressure, double phase, std::map<UInt, String> errors);
+    FiboxAnswer(double temperature, double pressure, double phase, FiboxStatus status);
 };
 
@@ -0,0 +1,283 @@
+#include "FiboxBus.h"
+#include "FiboxDriver.h"
+#include "../drivererror.h"
+#include "libusb-1.0/libusb.h"
+#include <iostream>
+#include <thread>
+#include <poll.h>
+#include <sys/epoll.h>
+
+/**
+ * @brief Callback function called by libusb when a Fibox device is plugged or unplugged (libusb_hotplug_event is not known by FiboxBus.h)
+ *
+ * @param ctx The libusb context
+ * @param device The libusb device concerned by the event
+ * @param event The hotplug event (arrived or left)
+ * @param userData The FiboxBus object
+ * @return Always 0 to keep the callback registered
+ */
+static int LIBUSB_CALL hotplugCallback(libusb_context* /*ctx*/, libusb_device* device, libusb_hotplug_event event, void* userData)
+{
+    if (event == LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED || event == LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT) {
+        reinterpret_cast<FiboxBus*>(userData)->notifyHotplug(device, event == LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED);
+    }
+    return 0;
+}
+
+FiboxBus::FiboxBus(EventLoop* loop)
+{
+    this->context = nullptr;
+    this->loop = loop;
+    this->usbTimer = -1;
+    this->hotplugRegistered = false;
+
+    int err = libusb_init(&context);
+    if (err != LIBUSB_SUCCESS) {
+        // The other sensors keep working, the Fibox initialization fails with this error on each RESET
+        this->context = nullptr;
+        this->initError = "Impossible d'initialiser la bibliothèque libusb. Détails : " + String(libusb_strerror(err)) + " (code d'erreur : " + to_string(err) + ").";
+        std::cout << "Fibox bus unavailable: libusb_init failed (" << libusb_strerror(err) << ")." << std::endl;
+        return;
+    }
+
+    // libusb events are handled by the daemon's event loop: watch its file descriptors and timeouts
+    this->usbTimer = loop->addTimer([this]() { handleEvents(); });
+
+    libusb_set_pollfd_notifiers(context, pollfdAdded, pollfdRemoved, this);
+    const libusb_pollfd** pollfds = libusb_get_pollfds(context);
+    if (pollfds != nullptr) {
+        for (int i = 0; pollfds[i] != nullptr; i++) {
+            watchPollfd(pollfds[i]->fd, pollfds[i]->events);
+        }
+        libusb_free_pollfds(pollfds);
+    }
+
+    // Watch the Fibox plug/unplug to attach the drivers without waiting for a RESET
+    if (libusb_has_capability(LIBUSB_CAP_HAS_HOTPLUG)) {
+        err = libusb_hotplug_register_callback(context, (libusb_hotplug_event)(LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED | LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT), LIBUSB_HOTPLUG_NO_FLAGS, VENDOR_ID, PRODUCT_ID, LIBUSB_HOTPLUG_MATCH_ANY, hotplugCallback, this, &hotplugHandle);
+        this->hotplugRegistered = (err == LIBUSB_SUCCESS);
+    }
+    if (!this->hotplugRegistered) {
+        std::cout << "Fibox hotplug detection unavailable, the devices will only be attached on RESET." << std::endl;
+    }
+}
+
+std::vector<FiboxDriver*> FiboxBus::discover()
+{
+    if (context == nullptr) {
+        throw DriverError("Impossible d'initialiser la communication avec le Fibox. " + initError);
+    }
+
+    // Discover connected USB devices
+    libusb_device **list;
+    ssize_t cnt = libusb_get_device_list(context, &list);
+
+    if (cnt < 0) {
+        throw DriverError("Impossible d'initialiser la communication avec le Fibox car une erreur est survenue lors de la récupération de la liste d'appareils connéctés.");
+    }
+
+    // Find all the Fibox devices
+    std::map<String, FiboxDriver*> found;
+    for (ssize_t i = 0; i < cnt; i++) {
+        if (isFibox(list[i])) {
+            String serial = readSerial(list[i]);
+            if (serial.empty()) {
+                std::cout << "Error while getting the serial number of a Fibox. Ignoring the device." << std::endl;
+            } else {
+                found[serial] = getOrCreateDriver(serial);
+            }
+        }
+    }
+    libusb_free_device_list(list, 1);
+
+    if (found.empty()) {
+        throw DriverError("Impossible d'initialiser la communication avec le Fibox car ce dernier est introuvable. Assurez vous que ce dernier soit bien alimenté et correctement connécté via son cable USB à la cellule de mesure.");
+    }
+
+    std::vector<FiboxDriver*> res;
+    for (const auto& pair : found) {
+        res.push_back(pair.second);
+    }
+    return res;
+}
+
+libusb_device* FiboxBus::findDevice(const String& serial)
+{
+    if (context == nullptr) {
+        throw DriverError("Impossible d'initialiser la communication avec le Fibox. " + initError);
+    }
+
+    libusb_device **list;
+    ssize_t cnt = libusb_get_device_list(context, &list);
+
+    if (cnt < 0) {
+        throw DriverError("Impossible d'initialiser la communication avec le Fibox car une erreur est survenue lors de la récupération de la liste d'appareils connéctés.");
+    }
+
+    libusb_device* found = nullptr;
+    for (ssize_t i = 0; i < cnt && found == nullptr; i++) {
+        if (isFibox(list[i]) && readSerial(list[i]) == serial) {
+            found = libusb_ref_device(list[i]);
+        }
+    }
+    libusb_free_device_list(list, 1);
+
+    return found;
+}
+
+std::vector<FiboxDriver*> FiboxBus::getDrivers()
+{
+    std::lock_guard<std::mutex> lock(driversMtx);
+
+    std::vector<FiboxDriver*> res;
+    for (const auto& pair : drivers) {
+        res.push_back(pair.second);
+    }
+    return res;
+}
+
+void FiboxBus::setNewDriverListener(std::function<void(FiboxDriver*)> listener)
+{
+    this->newDriverListener = listener;
+}
+
+FiboxDriver* FiboxBus::getOrCreateDriver(const String& serial)
+{
+    FiboxDriver* driver = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(driversMtx);
+        auto it = drivers.find(serial);
+        if (it != drivers.end()) {
+            return it->second;
+        }
+
+        driver = new FiboxDriver(this, serial);
+        drivers[serial] = driver;
+    }
+
+    if (newDriverListener) {
+        newDriverListener(driver);
+    }
+    return driver;
+}
+
+bool FiboxBus::isFibox(libusb_device* device)
+{
+    libusb_device_descriptor desc;
+    if (libusb_get_device_descriptor(device, &desc) != 0) {
+        std::cout << "Error while getting device descriptor. Ignoring the device." << std::endl;
+        return false;
+    }
+    return desc.idProduct == PRODUCT_ID && desc.idVendor == VENDOR_ID;
+}
+
+String FiboxBus::readSerial(libusb_device* device)
+{
+    libusb_device_descriptor desc;
+    if (libusb_get_device_descriptor(device, &desc) != 0) {
+        return "";
+    }
+
+    libusb_device_handle* handle = nullptr;
+    if (libusb_open(device, &handle) != 0) {
+        return "";
+    }
+
+    Byte serial[33] = {};
+    int err = libusb_get_string_descriptor_ascii(handle, desc.iSerialNumber, serial, 31);
+    libusb_close(handle);
+
+    if (err < 0) {
+        return "";
+    }
+    serial[32] = '\0';
+    return String((char*)serial);
+}
+
+void FiboxBus::notifyHotplug(libusb_device* device, bool arrived)
+{
+    if (arrived) {
+        // The serial number is read in the thread (control transfer)
+        std::thread t(&FiboxBus::processDeviceArrived, this, libusb_ref_device(device), std::chrono::steady_clock::now());
+        t.detach();
+    }
+    else {
+        for (FiboxDriver* driver : getDrivers()) {
+            driver->notifyDeviceLeft(device);
+        }
+    }
+}
+
+void FiboxBus::processDeviceArrived(libusb_device* device, std::chrono::steady_clock::time_point arrivedAt)
+{
+    String serial = readSerial(device);
+    if (serial.empty()) {
+        std::cout << "Fibox plugged but its serial number could not be read, waiting for a RESET." << std::endl;
+    } else {
+        FiboxDriver* driver = getOrCreateDriver(serial);
+        if (!driver->isAttached()) {
+            driver->processDeviceArrived(device, arrivedAt);
+        }
+    }
+
+    libusb_unref_device(device);
+}
+
+void FiboxBus::handleEvents()
+{
+    // Process what is ready without blocking the event loop
+    timeval zero = {0, 0};
+    libusb_handle_events_timeout_completed(context, &zero, nullptr);
+    updateEventsTimeout();
+}
+
+void FiboxBus::waitEvents(int timeoutMs)
+{
+    timeval timeout = {timeoutMs / 1000, (timeoutMs % 1000) * 1000};
+    libusb_handle_events_timeout_completed(context, &timeout, nullptr);
+    updateEventsTimeout();
+}
+
+void FiboxBus::updateEventsTimeout()
+{
+    timeval next;
+    if (libusb_get_next_timeout(context, &next) == 1) {
+        long delayUs = next.tv_sec * 1000000L + next.tv_usec;
+        loop->armTimer(usbTimer, delayUs > 0 ? delayUs : 1);
+    } else {
+        loop->armTimer(usbTimer, 0);
+    }
+}
+
+void FiboxBus::watchPollfd(int fd, short events)
+{
+    uint32_t epollEvents = 0;
+    if (events & POLLIN) {
+        epollEvents |= EPOLLIN;
+    }
+    if (events & POLLOUT) {
+        epollEvents |= EPOLLOUT;
+    }
+
+    loop->addFd(fd, epollEvents, [this](uint32_t) { handleEvents(); });
+}
+
+void FiboxBus::pollfdAdded(int fd, short events, void* userData)
+{
+    reinterpret_cast<FiboxBus*>(userData)->watchPollfd(fd, events);
+}
+
+void FiboxBus::pollfdRemoved(int fd, void* userData)
+{
+    reinterpret_cast<FiboxBus*>(userData)->loop->removeFd(fd);
+}
+
+libusb_context* FiboxBus::getContext() const
+{
+    return this->context;
+}
+
+EventLoop* FiboxBus::getLoop() const
+{
+    return this->loop;
+}
@@ -0,0 +1,212 @@
+#pragma once
+
+#include "../types.h"
+#include "../eventloop.h"
+#include <map>
+#include <mutex>
+#include <vector>
+#include <chrono>
+#include <functional>
+
+#define VENDOR_ID   0x00FF
+#define PRODUCT_ID  0x00FF
+
+class FiboxDriver;
+
+// The libusb types are only used through pointers here: libusb.h is included by the sources of the driver only,
+// so the rest of the daemon (and its tests) can be built without it
+struct libusb_context;
+struct libusb_device;
+struct libusb_device_handle;
+struct libusb_transfer;
+
+/**
+ * @brief FiboxBus - Shared USB side of the Fibox drivers
+ * It owns the libusb context (handled by the daemon's event loop) and the hotplug detection,
+ * and keeps one FiboxDriver per Fibox device, addressed by its USB serial number.
+ */
+class FiboxBus
+{
+private:
+    /**
+     * @brief The libusb context shared by all the Fibox drivers (nullptr if libusb_init failed)
+     */
+    libusb_context* context;
+
+    /**
+     * @brief The libusb_init error message (empty if the context has been initialized)
+     */
+    String initError;
+
+    /**
+     * @brief The event loop handling the libusb file descriptors and the timers
+     */
+    EventLoop* loop;
+
+    /**
+     * @brief The timer used for the libusb internal timeouts
+     */
+    int usbTimer;
+
+    /**
+     * @brief The Fibox drivers (key: USB serial number)
+     * Drivers are never removed: an unplugged Fibox keeps its driver until it is plugged again.
+     */
+    std::map<String, FiboxDriver*> drivers;
+
+    /**
+     * @brief Mutex protecting the drivers map
+     */
+    std::mutex driversMtx;
+
+    /**
+     * @brief Function called when a driver is created for a new serial number
+     */
+    std::function<void(FiboxDriver*)> newDriverListener;
+
+    /**
+     * @brief The hotplug callback handle (valid if hotplugRegistered is true)
+     */
+    int hotplugHandle; // libusb_hotplug_callback_handle
+
+    /**
+     * @brief True if the libusb hotplug callback has been registered
+     * False when the platform does not support hotplug, the Fibox devices are then only found on RESET.
+     */
+    bool hotplugRegistered;
+
+    /**
+     * @brief Handle the pending libusb events (transfers, hotplug and libusb timeouts) without blocking
+     * Called by the event loop when a libusb file descriptor is ready or when the libusb timer expires
+     */
+    void handleEvents();
+
+    /**
+     * @brief Register a libusb file descriptor in the event loop
+     *
+     * @param fd The file descriptor
+     * @param events The poll events (POLLIN, POLLOUT) to watch
+     */
+    void watchPollfd(int fd, short events);
+
+    /**
+     * @brief Callback function called by libusb when it opens a new file descriptor to watch
+     *
+     * @param fd The file descriptor
+     * @param events The poll events to watch
+     * @param userData The FiboxBus object
+     */
+    static void pollfdAdded(int fd, short events, void* userData);
+
+    /**
+     * @brief Callback function called by libusb when a file descriptor must not be watched anymore
+     *
+     * @param fd The file descriptor
+     * @param userData The FiboxBus object
+     */
+    static void pollfdRemoved(int fd, void* userData);
+
+    /**
+     * @brief Attach the driver of the Fibox device that just arrived (created if its serial number is new)
+     * Called in a thread
+     *
+     * @param device The libusb device (referenced by the callback, unreferenced here)
+     * @param arrivedAt The time at which libusb notified the arrival
+     */
+    void processDeviceArrived(libusb_device* device, std::chrono::steady_clock::time_point arrivedAt);
+
+    /**
+     * @brief Get the driver of a serial number, create it if needed
+     *
+     * @param serial The USB serial number
+     * @return The driver
+     */
+    FiboxDriver* getOrCreateDriver(const String& serial);
+
+    /**
+     * @brief Read the USB serial number of a device
+     *
+     * @param device The libusb device
+     * @return The serial number, empty on error
+     */
+    static String readSerial(libusb_device* device);
+
+    /**
+     * @brief Returns if the device is a Fibox (vendor and product ids)
+     *
+     * @param device The libusb device
+     * @return True if it is a Fibox
+     */
+    static bool isFibox(libusb_device* device);
+
+public:
+    /**
+     * @brief Construct a new Fibox Bus object
+     * It initializes the libusb context, registers its file descriptors in the event loop and the hotplug detection
+     * If libusb cannot be initialized, the error is logged and discover/findDevice throw it (the other sensors keep working)
+     *
+     * @param loop The daemon's event loop
+     */
+    FiboxBus(EventLoop* loop);
+
+    FiboxBus(const FiboxBus&) = delete;
+    FiboxBus& operator=(const FiboxBus&) = delete;
+
+    /**
+     * @brief Find the connected Fibox devices and create the drivers of the new serial numbers
+     * Must be call in a try instruction
+     *
+     * @return The drivers of the connected Fibox devices, sorted by serial number
+     */
+    std::vector<FiboxDriver*> discover();
+
+    /**
+     * @brief Find the connected Fibox device with the given serial number
+     * Must be call in a try instruction
+     *
+     * @param serial The USB serial number
+     * @return The libusb device (referenced, to unreference with libusb_unref_device), nullptr if not connected
+     */
+    libusb_device* findDevice(const String& serial);
+
+    /**
+     * @brief Get all the drivers created so far, sorted by serial number
+     *
+     * @return The drivers
+     */
+    std::vector<FiboxDriver*> getDrivers();
+
+    /**
+     * @brief Set the function called when a driver is created for a new serial number (on RESET or hotplug)
+     *
+     * @param listener The function
+     */
+    void setNewDriverListener(std::function<void(FiboxDriver*)> listener);
+
+    /**
+     * @brief Handle the plugging or the unplugging of a Fibox device (called by the libusb hotplug callback)
+     * It only records the event and delegates the work to a thread: the release has to wait for the event loop.
+     *
+     * @param device The libusb device concerned by the event
+     * @param arrived True if the device has been plugged, false if it left
+     */
+    void notifyHotplug(libusb_device* device, bool arrived);
+
+    /**
+     * @brief Handle the libusb events in the calling thread, blocking for at most timeoutMs
+     * Used by the drivers waiting for libusb to give their transfers back, which must not depend on the event loop
+     * (it may not be running yet). libusb serializes this handling with the one of the event loop.
+     *
+     * @param timeoutMs The maximum time to wait for an event in milliseconds
+     */
+    void waitEvents(int timeoutMs);
+
+    /**
+     * @brief Re-arm the libusb timer with the next timeout given by libusb_get_next_timeout
+     * To call after submitting a transfer with a timeout
+     */
+    void updateEventsTimeout();
+
+    libusb_context* getContext() const;
+    EventLoop* getLoop() const;
+};
@@ -1,21 +1,10 @@
 #include "FiboxDriver.h"
 #include "../drivererror.h"
+#include "libusb-1.0/libusb.h"
 #include <iostream>
 #include <thread>
 #include <unistd.h>
 
-Byte* FiboxDriver::toByteArrayPointer(BytesArray data)
-{
-    const int len = data.size();
-    Byte* res = new Byte[len];
-
-    for (int i = 0; i < len; i++) {
-        res[i] = data[i];
-    }
-
-    return res;
-}
-
 BytesArray FiboxDriver::toByteArray(Byte* data, const int len)
 {
     BytesArray res;
@@ -27,20 +16,38 @@ BytesArray FiboxDriver::toByteArray(Byte* data, const int len)
     return res;
 }
 
-FiboxDriver::FiboxDriver()
+FiboxDriver::FiboxDriver(FiboxBus* bus, String serial)
 {
-    mtx = new std::mutex();
-    mtx->lock();
-
-    timeoutWatcherId = 0;
     lastMeasureAnswer = nullptr;
 
-    this->getMeasureTimeout = false;
+    this->bus = bus;
+    this->serial = serial;
     this->packetReader = new PacketReader();
+    this->packetWriter = nullptr;
     this->devHandle = nullptr;
-
-    this->context = nullptr;
-    libusb_init(&context);
+    this->inTransfer = nullptr;
+    this->inTransferCancelled = false;
+    this->attachedDevice = nullptr;
+
+    // OUT transfers are allocated once and reused for every request
+    this->outInFlight = 0;
+    this->outRequestId = 0;
+    this->answerRequestId = 0;
+    this->answerExpected = false;
+    this->resyncReader = false;
+    this->outTransfers[0] = libusb_alloc_transfer(0);
+    this->outTransfers[1] = libusb_alloc_transfer(0);
+
+    this->reattachCount = 0;
+    this->lastReattachLatencyMs = 0;
+    this->maxReattachLatencyMs = 0;
+
+    this->lastStatus = 0U;
+    this->statusCounts.fill(0U);
+    this->statusLastSeen.fill(0);
+
+    this->loop = bus->getLoop();
+    this->requestTimer = loop->addTimer([this]() { handleTimeout(); });
 
     this->criticalError = false;
     this->enableTempFibox = false;
@@ -48,66 +55,49 @@ FiboxDriver::FiboxDriver()
 
 void FiboxDriver::initFiboxCommunication()
 {
-    while (!mtx->try_lock()) {
-		mtx->unlock();
-	}
+    std::lock_guard<std::mutex> lock(initMtx);
 
-    this->packetReader->reset();
+    releaseDevice();
 
-    if (this->devHandle != nullptr) {
-        libusb_release_interface(this->devHandle, 0);
-        libusb_close(this->devHandle);
+    // Find the device with our serial number
+    libusb_device* found = bus->findDevice(serial);
+    if (!found) {
+        throw DriverError("Impossible d'initialiser la communication avec le Fibox " + serial + " car ce dernier est introuvable. Assurez vous que ce dernier soit bien alimenté et correctement connécté via son cable USB à la cellule de mesure.");
     }
-    this->devHandle = nullptr;
-    this->getMeasureTimeout = false;
-    this->timeoutWatcherId = 0;
 
-    // Discover connected USB devices
-    libusb_device **list;
-    libusb_device *found = NULL;
-    ssize_t cnt = libusb_get_device_list(context, &list);
-
-    if (cnt < 0) {
-        throw DriverError("Impossible d'initialiser la communication avec le Fibox car une erreur est survenue lors de la récupération de la liste d'appareils connéctés.");
+    try
+    {
+        attach(found);
     }
-
-    // Try to find Fibox device
-    libusb_device_descriptor desc;
-    for (ssize_t i = 0; i < cnt; i++) {
-        libusb_device *device = list[i];
-
-        if (libusb_get_device_descriptor(device, &desc) != 0) {
-            std::cout << "Error while getting device descriptor. Ignoring the device." << std::endl;
-        } else {
-            if (desc.idProduct == PRODUCT_ID && desc.idVendor == VENDOR_ID) {
-                found = device;
-                break;
-            }
-        }
+    catch (const DriverError&)
+    {
+        libusb_unref_device(found);
+        throw;
     }
+    libusb_unref_device(found);
+}
 
-    if (found) {
-        int err = libusb_open(found, &devHandle);
-        if (err) {
-            throw DriverError("Impossible d'initialiser la communication avec le Fibox car une erreur est survenue lors de la tentative de connexion. Assurez vous que ce dernier soit bien alimenté et correctement connécté via son cable USB à la cellule de mesure. Détails : " + String(libusb_strerror(err)) + " (code d'erreur : " + to_string(err) + ").");
-        }
+void FiboxDriver::attach(libusb_device* device)
+{
+    // The opened handle keeps its own reference on the device
+    int err = libusb_open(device, &devHandle);
+    if (err) {
+        devHandle = nullptr;
+        throw DriverError("Impossible d'initialiser la communication avec le Fibox car une erreur est survenue lors de la tentative de connexion. Assurez vous que ce dernier soit bien alimenté et correctement connécté via son cable USB à la cellule de mesure. Détails : " + String(libusb_strerror(err)) + " (code d'erreur : " + to_string(err) + ").");
+    }
 
-        // Get the SerialNumber to initialize the packet writer
-        auto* serial = new Byte[33]();
-        err = libusb_get_string_descriptor_ascii(devHandle, desc.iSerialNumber, serial, 31);
-        if (err >= 0) {
-            serial[32] = '\0';
-            packetWriter = new PacketWriter((char*)serial);
+    // The SerialNumber initializes the packet writer
+    if (packetWriter == nullptr) {
+        try
+        {
+            packetWriter = new PacketWriter(serial);
         }
-        else {
-            throw DriverError("Impossible d'initialiser la communication avec le Fibox car une erreur est survenu lors de la récupération de son numéro de série.");
+        catch (...)
+        {
+            throw DriverError("Impossible d'initialiser la communication avec le Fibox car son numéro de série (" + serial + ") n'a pas le format attendu.");
         }
-    } else {
-        throw DriverError("Impossible d'initialiser la communication avec le Fibox car ce dernier est introuvable. Assurez vous que ce dernier soit bien alimenté et correctement connécté via son cable USB à la cellule de mesure.");
     }
 
-    libusb_free_device_list(list, 1);
-
     // Claim the interface before performing any data transfer
     if (libusb_claim_interface(this->devHandle, 0) < 0) {
         this->criticalError = true;
@@ -121,77 +111,82 @@ void FiboxDriver::initFiboxCommunication()
         throw DriverError("Impossible d'initialiser la communication avec le Fibox (transfer structure allocation error).");
     }
 
-    // Allocate transfer buffer
-    unsigned char buffer[64];
-    libusb_fill_bulk_transfer(transfer, devHandle, ENDPOINT_IN, buffer, 64, callback, this, 0);
+    // Allocate transfer buffer (freed with the transfer in the callback)
+    Byte* buffer = new Byte[IN_BUFFER_SIZE];
+    libusb_fill_bulk_transfer(transfer, devHandle, ENDPOINT_IN, buffer, IN_BUFFER_SIZE, callback, this, 0);
 
     // Submit the transfer
-    libusb_submit_transfer(transfer);
+    {
+        std::lock_guard<std::mutex> transferLock(transferMtx);
+        err = libusb_submit_transfer(transfer);
+        if (err) {
+            delete[] buffer;
+            libusb_free_transfer(transfer);
+            this->criticalError = true;
+            throw DriverError("Impossible d'initialiser la communication avec le Fibox car la demande de lecture a échouée. Détails : " + String(libusb_strerror(err)) + " (code d'erreur : " + to_string(err) + ").");
+        }
+        inTransfer = transfer;
+        inTransferCancelled = false;
+    }
 
     this->criticalError = false;
-    std::thread handlerThread(&FiboxDriver::handleEvents, this);
-    handlerThread.detach();
+    this->attachedDevice = libusb_get_device(devHandle);
 }
 
-FiboxAnswer* FiboxDriver::getMeasure()
+void FiboxDriver::releaseDevice()
 {
-    UShort id = packetWriter->getRequestId();
-    BytesArray header_packet = packetWriter->prepareGetMeasureRequestHeader(id);
-    BytesArray footer_packet = packetWriter->prepareGetMeasureRequestFooter(id);
+    this->attachedDevice = nullptr;
 
-    try
+    // Cancel the pending IN transfer, the callback frees it instead of re-submitting it
     {
-        sendData(header_packet);
-        sendData(footer_packet);
+        std::lock_guard<std::mutex> transferLock(transferMtx);
+        inTransferCancelled = true;
+        if (inTransfer != nullptr) {
+            libusb_cancel_transfer(inTransfer);
+        }
     }
-    catch (const DriverError e)
+
+    // Cancel the pending OUT transfers and give up the pending requests
     {
-        throw e;
+        std::lock_guard<std::mutex> requestLock(requestMtx);
+        if (outInFlight > 0) {
+            libusb_cancel_transfer(outTransfers[0]);
+            libusb_cancel_transfer(outTransfers[1]);
+        }
+        failPendingRequests("Impossible de lire les données de mesure du Fibox car la communication a été interrompue (appareil déconnecté ou réinitialisé).");
     }
 
-    // Timeout thread
-    std::thread timeoutThread(&FiboxDriver::handleTimeout, this, timeoutWatcherId);
-    timeoutThread.detach();
-
-    // Wait the new data to arrived
-    mtx->lock();
-    timeoutWatcherId++;
-
-    // Check wait timeout
-    if (getMeasureTimeout) {
-        criticalError = true;
-        throw DriverError("Impossible de lire les données de mesure du Fibox car le délai de réponse est dépassé.");
+    // The handle must outlive the transfers: wait for libusb to give all of them back, handling the events here
+    while (!transfersOver()) {
+        bus->waitEvents(RELEASE_POLL_MS);
     }
 
-    // Check for other sensor error
-    if (lastMeasureAnswer->errors.size() != 0) {
-        bool throwErrs = false;
-        String errors = "Le Fibox a retourné une/plusieurs erreur(s).\\n";
-        for (const auto& pair : lastMeasureAnswer->errors) {
-            if (pair.first != 1U || enableTempFibox) {
-                errors += pair.second + " (code d'erreur : " + to_string(pair.first) + ").\\n";
-                throwErrs = true;
-            }
-        }
-
-        if (throwErrs) {
-            errors.pop_back();
-            errors.pop_back();
-            this->criticalError = true;
-            throw DriverError(errors);
-        }
+    if (this->devHandle != nullptr) {
+        libusb_release_interface(this->devHandle, 0);
+        libusb_close(this->devHandle);
     }
+    this->devHandle = nullptr;
 
-    return lastMeasureAnswer;
+    this->packetReader->reset();
 }
 
-void FiboxDriver::setEnableTempFibox(bool state)
+bool FiboxDriver::transfersOver()
 {
-    this->enableTempFibox = state;
+    {
+        std::lock_guard<std::mutex> transferLock(transferMtx);
+        if (inTransfer != nullptr) {
+            return false;
+        }
+    }
+
+    std::lock_guard<std::mutex> requestLock(requestMtx);
+    return outInFlight == 0;
 }
 
-void FiboxDriver::sendData(BytesArray data)
+FiboxAnswer* FiboxDriver::getMeasure()
 {
+    // The handle is used until the request is submitted, it must not be released meanwhile
+    std::unique_lock<std::mutex> initLock(initMtx);
     if (!devHandle) {
         throw DriverError("Impossible d'envoyer la demande de mesure au Fibox car la communication s'est mal initialisée (devHandle null).");
     }
@@ -199,61 +194,287 @@ void FiboxDriver::sendData(BytesArray data)
         throw DriverError("Impossible d'envoyer la demande de mesure au Fibox car une erreur critique de communication est survenue précédemment (criticalError mode).");
     }
 
-    int transferred;
-    int result = libusb_bulk_transfer(devHandle, ENDPOINT_OUT, toByteArrayPointer(data), data.size(), &transferred, 0);
-    if (result != 0) {
+    UShort id = packetWriter->getRequestId();
+
+    std::unique_lock<std::mutex> lock(requestMtx);
+
+    // The OUT buffer is reused: the transfers of the previous request must have been given back
+    requestCv.wait_for(lock, std::chrono::milliseconds(2 * OUT_TIMEOUT_MS), [this] { return outInFlight == 0; });
+    if (outInFlight != 0) {
+        this->criticalError = true;
+        throw DriverError("Impossible d'envoyer la demande de mesure au Fibox car la demande précédente est toujours en cours d'envoi.");
+    }
+
+    // Both packets are written in the same buffer and submitted together, each one keeps its own USB transfer
+    packetWriter->writeGetMeasureRequest(id, outBuffer);
+    libusb_fill_bulk_transfer(outTransfers[0], devHandle, ENDPOINT_OUT, outBuffer, REQUEST_HEADER_SIZE, outCallback, this, OUT_TIMEOUT_MS);
+    libusb_fill_bulk_transfer(outTransfers[1], devHandle, ENDPOINT_OUT, outBuffer + REQUEST_HEADER_SIZE, REQUEST_FOOTER_SIZE, outCallback, this, OUT_TIMEOUT_MS);
+
+    requests[id] = FiboxRequest{ FiboxRequest::PENDING, nullptr, "" };
+    outRequestId = id;
+    answerRequestId = id;
+    answerExpected = true;
+    outInFlight = 2;
+    lock.unlock();
+
+    // Submitted outside of the lock: libusb may be running the callbacks in the event loop
+    for (int i = 0; i < 2; i++) {
+        int result = libusb_submit_transfer(outTransfers[i]);
+        if (result != 0) {
+            lock.lock();
+            outInFlight -= 2 - i;
+            answerExpected = false;
+            requests.erase(id);
+            requestCv.notify_all();
+            lock.unlock();
+
+            this->criticalError = true;
+            if (result == LIBUSB_ERROR_NO_DEVICE) {
+                // Unplugged before the hotplug event was handled
+                this->attachedDevice = nullptr;
+            }
+            throw DriverError("Impossible d'envoyer la demande de mesure au Fibox. Assurez vous que ce dernier soit bien alimenté et correctement connécté via son cable USB à la cellule de mesure. Détails : " + String(libusb_strerror(result)) + " (code d'erreur : " + to_string(result) + ").");
+        }
+    }
+    initLock.unlock();
+    bus->updateEventsTimeout();
+
+    // Timeout timer (disarmed by the callback when the answer arrives)
+    loop->armTimer(requestTimer, ANSWER_TIMEOUT_US);
+
+    // Wait the new data to arrived (or the request to fail)
+    lock.lock();
+    requestCv.wait(lock, [this, id] { return requests[id].state == FiboxRequest::ANSWERED || requests[id].state == FiboxRequest::FAILED; });
+    FiboxRequest request = requests[id];
+    requests.erase(id);
+    lock.unlock();
+
+    if (request.state == FiboxRequest::FAILED) {
+        criticalError = true;
+        throw DriverError(request.error);
+    }
+
+    // The previous answer is not used by the caller anymore
+    delete lastMeasureAnswer;
+    lastMeasureAnswer = request.answer;
+
+    // Check for other sensor error (the PT100 is ignored if the temperature sensor is disabled)
+    UInt statusBits = lastMeasureAnswer->status.bits;
+    if (!enableTempFibox) {
+        statusBits &= ~(UInt)FIBOX_STATUS_PT100_DISCONNECTED;
+    }
+
+    if (statusBits != 0U) {
+        String errors = "Le Fibox a retourné une/plusieurs erreur(s).\\n";
+        for (UInt index = 0; index < FIBOX_STATUS_BITS; index++) {
+            UInt bit = 1U << index;
+            if (statusBits & bit) {
+                errors += String(FiboxStatus::message(index)) + " (code d'erreur : " + to_string(bit) + ").\\n";
+            }
+        }
+
+        errors.pop_back();
+        errors.pop_back();
         this->criticalError = true;
-        throw DriverError("Impossible d'envoyer la demande de mesure au Fibox. Assurez vous que ce dernier soit bien alimenté et correctement connécté via son cable USB à la cellule de mesure. Détails : " + String(libusb_strerror(result)) + " (code d'erreur : " + to_string(result) + ").");
+        throw DriverError(errors);
     }
 
-    while (!transferred) {
-        sleep(1);
+    return lastMeasureAnswer;
+}
+
+void FiboxDriver::recordStatus(FiboxStatus status)
+{
+    this->lastStatus = status.bits;
+    if (status.isClean()) {
+        return;
+    }
+
+    // Only the set bits are visited
+    std::lock_guard<std::mutex> lock(statusMtx);
+    time_t now = time(nullptr);
+    UInt bits = status.bits;
+    while (bits != 0U) {
+        int index = __builtin_ctz(bits);
+        statusCounts[index]++;
+        statusLastSeen[index] = now;
+        bits &= bits - 1U;
     }
 }
 
+void FiboxDriver::setEnableTempFibox(bool state)
+{
+    this->enableTempFibox = state;
+}
+
 void FiboxDriver::callback(libusb_transfer* transfer) {
     FiboxDriver* this_ = reinterpret_cast<FiboxDriver*>(transfer->user_data);
-    if (transfer->status != LIBUSB_TRANSFER_COMPLETED) {
+    if (transfer->status == LIBUSB_TRANSFER_COMPLETED) {
+        // Handle incoming data
+        unsigned char* data = transfer->buffer;
+        int actual_length = transfer->actual_length;
+
+        // Process received data
+        BytesArray packet = BytesArray();
+        for (int i = 0; i < actual_length; ++i) {
+            packet.push_back(data[i]);
+        }
+
+        // The partial answer of a timed out request is dropped, the reader waits for the next header
+        if (this_->resyncReader.exchange(false)) {
+            this_->packetReader->reset();
+        }
+
+        FiboxAnswer* answer = this_->packetReader->processMessage(packet);
+        if (answer != nullptr) { // complete fibox answer returned
+            answer->isTemperatureEnabled = this_->enableTempFibox;
+            this_->recordStatus(answer->status);
+
+            // Report the answer to the request in flight (only one request is sent at a time)
+            std::lock_guard<std::mutex> requestLock(this_->requestMtx);
+            auto it = this_->requests.end();
+            if (this_->answerExpected) {
+                it = this_->requests.find(this_->answerRequestId);
+            }
+            if (it != this_->requests.end() && (it->second.state == FiboxRequest::PENDING || it->second.state == FiboxRequest::SENT)) {
+                this_->answerExpected = false;
+                this_->loop->armTimer(this_->requestTimer, 0);
+                it->second.state = FiboxRequest::ANSWERED;
+                it->second.answer = answer;
+                this_->requestCv.notify_all();
+            } else {
+                // Late answer of a request that already failed (timeout, release)
+                delete answer;
+            }
+        }
+    }
+
+    // Re-submit the transfer, unless the device is being released (checked with the lock held by releaseDevice
+    // when it cancels the transfer, so a transfer cannot be re-submitted after its cancellation)
+    std::lock_guard<std::mutex> transferLock(this_->transferMtx);
+    if (transfer->status == LIBUSB_TRANSFER_COMPLETED && !this_->inTransferCancelled && libusb_submit_transfer(transfer) == 0) {
         return;
     }
 
-    // Handle incoming data
-    unsigned char* data = transfer->buffer;
-    int actual_length = transfer->actual_length;
+    // The transfer is over (cancelled, device unplugged...), free it
+    if (this_->inTransfer == transfer) {
+        this_->inTransfer = nullptr;
+    }
+    delete[] transfer->buffer;
+    libusb_free_transfer(transfer);
+}
 
-    // Process received data
-    BytesArray packet = BytesArray();
-    for (int i = 0; i < actual_length; ++i) {
-        packet.push_back(data[i]);
+void FiboxDriver::outCallback(libusb_transfer* transfer) {
+    FiboxDriver* this_ = reinterpret_cast<FiboxDriver*>(transfer->user_data);
+
+    std::lock_guard<std::mutex> requestLock(this_->requestMtx);
+    this_->outInFlight--;
+
+    auto it = this_->requests.find(this_->outRequestId);
+    if (it != this_->requests.end() && it->second.state == FiboxRequest::PENDING) {
+        if (transfer->status != LIBUSB_TRANSFER_COMPLETED) {
+            if (transfer->status == LIBUSB_TRANSFER_NO_DEVICE) {
+                this_->attachedDevice = nullptr;
+            }
+            it->second.state = FiboxRequest::FAILED;
+            it->second.error = "Impossible d'envoyer la demande de mesure au Fibox. Assurez vous que ce dernier soit bien alimenté et correctement connécté via son cable USB à la cellule de mesure. Détails : le transfert USB a échoué (statut : " + to_string(transfer->status) + ").";
+        }
+        else if (transfer == this_->outTransfers[1]) {
+            it->second.state = FiboxRequest::SENT;
+        }
     }
 
-    FiboxAnswer* answer = this_->packetReader->processMessage(packet);
-    if (answer != nullptr) { // complete fibox answer returned
-        answer->isTemperatureEnabled = this_->enableTempFibox;
-        this_->lastMeasureAnswer = answer;
-        this_->mtx->unlock();
+    this_->requestCv.notify_all();
+}
+
+void FiboxDriver::failPendingRequests(const String& error)
+{
+    answerExpected = false;
+    for (auto& pair : requests) {
+        if (pair.second.state == FiboxRequest::PENDING || pair.second.state == FiboxRequest::SENT) {
+            pair.second.state = FiboxRequest::FAILED;
+            pair.second.error = error;
+        }
     }
+    requestCv.notify_all();
+}
+
+void FiboxDriver::notifyDeviceLeft(libusb_device* device)
+{
+    if (device == this->attachedDevice) {
+        // Refuse new requests right now, the release is done in the thread
+        this->attachedDevice = nullptr;
+        this->criticalError = true;
 
-    // Re-submit the transfer
-    libusb_submit_transfer(transfer);
+        std::thread t(&FiboxDriver::processDeviceLeft, this, device);
+        t.detach();
+    }
 }
 
-void FiboxDriver::handleTimeout(int id)
+void FiboxDriver::processDeviceArrived(libusb_device* device, std::chrono::steady_clock::time_point arrivedAt)
 {
-    // Handle timeout
-    this->getMeasureTimeout = false;
-    sleep(3);
-    if (!mtx->try_lock() && timeoutWatcherId == id) { // if ids are different, the request has been answered before the timeout
-        this->getMeasureTimeout = true;
-        mtx->unlock();
+    try
+    {
+        std::lock_guard<std::mutex> lock(initMtx);
+        releaseDevice();
+        attach(device);
+    }
+    catch (const DriverError& e)
+    {
+        std::cout << "Fibox " << serial << " re-attachment failed: " << e.message << std::endl;
+        return;
     }
+
+    double latency = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - arrivedAt).count();
+    reattachCount++;
+    lastReattachLatencyMs = latency;
+    if (latency > maxReattachLatencyMs) {
+        maxReattachLatencyMs = latency;
+    }
+
+    std::cout << "Fibox " << serial << " re-attached in " << latency << " ms." << std::endl;
 }
 
-void FiboxDriver::handleEvents()
+void FiboxDriver::processDeviceLeft(libusb_device* device)
 {
-    // Handle events
-    while (!criticalError) {
-        libusb_handle_events(context);
+    std::lock_guard<std::mutex> lock(initMtx);
+
+    // The device may already have been replaced by a new arrival
+    if (devHandle != nullptr && libusb_get_device(devHandle) == device) {
+        releaseDevice();
+        std::cout << "Fibox " << serial << " unplugged, waiting for it to be plugged again." << std::endl;
     }
-    printf("Handler thread exited due to a comm error.\n");
+}
+
+void FiboxDriver::handleTimeout()
+{
+    // The request has not been answered in time (the timer is disarmed by the callback otherwise)
+    std::lock_guard<std::mutex> requestLock(requestMtx);
+    failPendingRequests("Impossible de lire les données de mesure du Fibox car le délai de réponse est dépassé.");
+    resyncReader = true;
+}
+
+String FiboxDriver::getSerial() const
+{
+    return this->serial;
+}
+
+bool FiboxDriver::isAttached() const
+{
+    return this->attachedDevice != nullptr;
+}
+
+FiboxLinkStats FiboxDriver::getLinkStats() const
+{
+    FiboxLinkStats stats;
+    stats.serial = serial;
+    stats.attached = isAttached();
+    stats.reattachCount = reattachCount;
+    stats.lastReattachLatencyMs = lastReattachLatencyMs;
+    stats.maxReattachLatencyMs = maxReattachLatencyMs;
+    stats.lastStatus = lastStatus;
+
+    std::lock_guard<std::mutex> lock(statusMtx);
+    stats.statusCounts = statusCounts;
+    stats.statusLastSeen = statusLastSeen;
+    return stats;
 }
@@ -3,18 +3,29 @@
 #include "../types.h"
 #include "packetreader.h"
 #include "packetwriter.h"
-#include "libusb-1.0/libusb.h"
+#include "FiboxLinkStats.h"
+#include "FiboxRequest.h"
+#include "FiboxBus.h"
 #include "../MeasureConfig.h"
 #include <mutex>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <array>
+#include <ctime>
 
-#define VENDOR_ID   0x00FF
-#define PRODUCT_ID  0x00FF
 #define ENDPOINT_IN 0x81                // Endpoint for data IN
 #define ENDPOINT_OUT 0x01               // Endpoint for data OUT
+#define IN_BUFFER_SIZE 64               // Size of the IN transfer buffer
+#define OUT_BUFFER_SIZE (REQUEST_HEADER_SIZE + REQUEST_FOOTER_SIZE) // Size of the OUT buffer (request header + footer)
+#define OUT_TIMEOUT_MS 1000             // Delay for the OUT transfers to be completed
+#define ANSWER_TIMEOUT_US 3000000       // Delay for the Fibox to answer a measure request
+#define RELEASE_POLL_MS 100             // Maximum time spent handling the libusb events between two checks of the cancelled transfers
 
 /**
  * @brief FiboxDriver - Fibox driver class
- * It implements the Fibox communication protocol to communicate with the Fibox device
+ * It implements the Fibox communication protocol to communicate with one Fibox device, identified by its USB serial number
  */
 class FiboxDriver
 {
@@ -25,9 +36,14 @@ private:
     libusb_device_handle* devHandle;
 
     /**
-     * @brief The libusb context of the Fibox device
+     * @brief The bus sharing the libusb context and the event loop between the Fibox drivers
      */
-    libusb_context* context;
+    FiboxBus* bus;
+
+    /**
+     * @brief The USB serial number of the Fibox device
+     */
+    String serial;
 
     /**
      * @brief The packet reader object
@@ -39,14 +55,6 @@ private:
      */
     PacketWriter* packetWriter;
 
-    /**
-     * @brief Convert a BytesArray to a Byte pointer
-     *
-     * @param data The BytesArray to convert
-     * @return The Byte pointer
-     */
-    Byte* toByteArrayPointer(BytesArray data);
-
     /**
      * @brief Convert a Byte pointer to a BytesArray
      *
@@ -63,31 +71,125 @@ private:
      */
     static void callback(libusb_transfer* transfer);
 
+    /**
+     * @brief Callback function called when an OUT transfer (request header or footer) is over
+     * It reports the completion (or the failure) to the request table.
+     *
+     * @param transfer The libusb transfer object
+     */
+    static void outCallback(libusb_transfer* transfer);
+
+    /**
+     * @brief Mark all the unfinished requests of the table as failed and wake up their waiter
+     * Must be called with requestMtx locked
+     *
+     * @param error The error message given to the requests
+     */
+    void failPendingRequests(const String& error);
+
     /**
      * @brief Handle the timeout if a request to the Fibox device is not answered after 3 seconds
-     * Called in a thread
+     * Called by the event loop when the request timer expires
+     */
+    void handleTimeout();
+
+    /**
+     * @brief The event loop handling the timers
+     */
+    EventLoop* loop;
+
+    /**
+     * @brief The timer used for the measure request timeout
+     */
+    int requestTimer;
+
+    /**
+     * @brief Attach the driver to its device (open, claim and submit the IN transfer)
+     * Must be called with initMtx locked, must be call in a try instruction
      *
-     * @param id The id of the transfer
+     * @param device The libusb device
      */
-    void handleTimeout(int id);
+    void attach(libusb_device* device);
 
     /**
-     * @brief Loop to handle the events of the Fibox device
+     * @brief Tear down the driver after its Fibox device left
      * Called in a thread
+     *
+     * @param device The libusb device that left
      */
-    void handleEvents();
+    void processDeviceLeft(libusb_device* device);
 
     /**
-     * @brief The critical error flag
-     * True in case of a critical error during the communication.
+     * @brief Release the current device (IN transfer, interface and handle)
+     * The transfers are cancelled and the handle is only closed once libusb gave all of them back.
+     * Must be called with initMtx locked
      */
-    bool criticalError;
+    void releaseDevice();
 
     /**
-     * @brief The flag to get the measure timeout
-     * True if the measure request is not answered in time.
+     * @brief Returns if libusb gave back the IN and the OUT transfers (none of them uses the handle anymore)
+     *
+     * @return True if no transfer is in flight
      */
-    bool getMeasureTimeout;
+    bool transfersOver();
+
+    /**
+     * @brief Mutex serializing the attach/release of the device (RESET and hotplug threads)
+     * It also protects devHandle: getMeasure holds it while it submits the request on the handle.
+     */
+    std::mutex initMtx;
+
+    /**
+     * @brief The libusb device currently attached (nullptr if none)
+     */
+    std::atomic<libusb_device*> attachedDevice;
+
+    /**
+     * @brief The pending IN transfer (nullptr if none)
+     * Protected by transferMtx.
+     */
+    libusb_transfer* inTransfer;
+
+    /**
+     * @brief True once the IN transfer has been cancelled: the callback does not re-submit it anymore
+     * Protected by transferMtx.
+     */
+    bool inTransferCancelled;
+    std::mutex transferMtx;
+
+    /**
+     * @brief Re-attachment metrics (see FiboxLinkStats)
+     */
+    std::atomic<UInt> reattachCount;
+    std::atomic<double> lastReattachLatencyMs;
+    std::atomic<double> maxReattachLatencyMs;
+
+    /**
+     * @brief The status word of the last answer
+     */
+    std::atomic<UInt> lastStatus;
+
+    /**
+     * @brief Number of answers having each status bit set, and the last time it was seen
+     * Protected by statusMtx.
+     */
+    std::array<UInt, FIBOX_STATUS_BITS> statusCounts;
+    std::array<time_t, FIBOX_STATUS_BITS> statusLastSeen;
+    mutable std::mutex statusMtx;
+
+    /**
+     * @brief Update the status counters with the status word of an answer
+     * Nothing is done but storing the word when the status is clean.
+     *
+     * @param status The status word
+     */
+    void recordStatus(FiboxStatus status);
+
+    /**
+     * @brief The critical error flag
+     * True in case of a critical error during the communication.
+     */
+    bool criticalError;
 
     /**
      * @brief The flag to enable the temperature measure from the Fibox device
@@ -97,43 +199,100 @@ private:
     bool enableTempFibox;
 
     /**
-     * @brief Send data to the Fibox device
-     * Must be call in a try instruction
-     * 
-     * @param data The data to send
+     * @brief The request table (key: request id)
+     * Filled by getMeasure and completed by the libusb callbacks and the timeout timer.
+     */
+    std::map<UShort, FiboxRequest> requests;
+
+    /**
+     * @brief Mutex protecting the request table and the OUT transfers
+     * requestCv is notified each time a request or an OUT transfer is over.
+     */
+    std::mutex requestMtx;
+    std::condition_variable requestCv;
+
+    /**
+     * @brief The id of the request being sent by the OUT transfers
+     */
+    UShort outRequestId;
+
+    /**
+     * @brief The id of the request the next complete answer belongs to (valid if answerExpected is true)
+     * Set when the request is submitted, cleared when it is answered or fails: an answer arriving while no request
+     * waits (late answer of a timed out request) is discarded instead of being given to the next request.
+     */
+    UShort answerRequestId;
+    bool answerExpected;
+
+    /**
+     * @brief Set by the timeout: the packet reader drops its partial answer before reading the next packet
+     * The reader is only used by the IN callback, so the reset is done there.
      */
-    void sendData(BytesArray data);
+    std::atomic<bool> resyncReader;
 
     /**
-     * @brief Mutex to lock the access to the Fibox device
-     * It prevent multiple access to the Fibox device
+     * @brief Number of OUT transfers submitted and not given back yet by libusb
      */
-    std::mutex* mtx;
+    int outInFlight;
 
     /**
-     * @brief The timeout watcher id
-     * It's used to check if a timeout occured
+     * @brief The preallocated OUT buffer holding the request header followed by its footer
      */
-    int timeoutWatcherId;
+    Byte outBuffer[OUT_BUFFER_SIZE];
 
     /**
-     * @brief The last measure answer pointer
+     * @brief The preallocated OUT transfers (header and footer), submitted together
+     */
+    libusb_transfer* outTransfers[2];
+
+    /**
+     * @brief The last measure answer pointer (freed when a new answer is returned)
      */
     FiboxAnswer* lastMeasureAnswer;
 
 public:
     /**
      * @brief Construct a new Fibox Driver object
-     * It initializes the reader/writer objects and the libusb context
+     * It initializes the reader object and the request transfers, the device is attached by initFiboxCommunication or on hotplug
+     *
+     * @param bus The bus owning the libusb context
+     * @param serial The USB serial number of the Fibox device
      */
-    FiboxDriver();
+    FiboxDriver(FiboxBus* bus, String serial);
+
+    FiboxDriver(const FiboxDriver&) = delete;
+    FiboxDriver& operator=(const FiboxDriver&) = delete;
 
     /**
-     * @brief Initialize the Fibox communication
+     * @brief Initialize the Fibox communication (find the device with the serial number and attach it)
      * Must be call in a try instruction
      */
     void initFiboxCommunication();
 
+    /**
+     * @brief Re-attach the driver to its Fibox device that just arrived
+     * Called in a thread by the bus on hotplug
+     *
+     * @param device The libusb device
+     * @param arrivedAt The time at which libusb notified the arrival
+     */
+    void processDeviceArrived(libusb_device* device, std::chrono::steady_clock::time_point arrivedAt);
+
+    /**
+     * @brief Tear down the driver if the device that left is its device
+     * Called by the bus hotplug callback, the release is done in a thread
+     *
+     * @param device The libusb device that left
+     */
+    void notifyDeviceLeft(libusb_device* device);
+
+    /**
+     * @brief Get the USB serial number of the Fibox device
+     *
+     * @return The serial number
+     */
+    String getSerial() const;
+
     /**
      * @brief Get the measure from the Fibox device
      * Must be call in a try instruction
@@ -149,4 +308,19 @@ public:
      */
     void setEnableTempFibox(bool state);
 
+    /**
+     * @brief Returns if the driver is attached to a Fibox device
+     * False after the device has been unplugged, until it is plugged again (or reset).
+     *
+     * @return True if attached
+     */
+    bool isAttached() const;
+
+    /**
+     * @brief Get the state of the USB link, the re-attachment metrics and the status bits counters
+     *
+     * @return The link statistics
+     */
+    FiboxLinkStats getLinkStats() const;
+
 };
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "../types.h"
+#include "FiboxStatus.h"
+#include <array>
+#include <ctime>
+
+/**
+* FiboxLinkStats - State of the USB link with the Fibox device
+* It is used to follow the hotplug detections (unplug/replug), the time needed to re-attach the driver and the status bits reported by the device.
+*/
+struct FiboxLinkStats
+{
+    /**
+     * @brief The USB serial number of the Fibox device
+     */
+    String serial;
+
+    /**
+     * @brief True if the driver is currently attached to a Fibox device
+     */
+    bool attached;
+
+    /**
+     * @brief Number of automatic re-attachments done after a hotplug detection
+     */
+    UInt reattachCount;
+
+    /**
+     * @brief Time (in milliseconds) between the last device arrival and the driver being ready again
+     */
+    double lastReattachLatencyMs;
+
+    /**
+     * @brief Longest re-attachment time (in milliseconds) since the daemon started
+     */
+    double maxReattachLatencyMs;
+
+    /**
+     * @brief The status word of the last answer
+     */
+    UInt lastStatus;
+
+    /**
+     * @brief Number of answers having each status bit set (index: bit index)
+     */
+    std::array<UInt, FIBOX_STATUS_BITS> statusCounts;
+
+    /**
+     * @brief Last time each status bit has been seen (0 if never)
+     */
+    std::array<time_t, FIBOX_STATUS_BITS> statusLastSeen;
+};
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "../types.h"
+#include "FiboxAnswer.h"
+
+/**
+* FiboxRequest - Entry of the Fibox driver request table
+* It follows a measure request from its submission to its answer (or its failure)
+*/
+struct FiboxRequest
+{
+    enum State
+    {
+        PENDING,    // OUT transfers submitted
+        SENT,       // OUT transfers completed, waiting for the answer
+        ANSWERED,   // Answer received (see answer)
+        FAILED      // OUT transfer error, timeout or device released (see error)
+    };
+
+    State state;
+
+    /**
+     * @brief The Fibox answer (set when ANSWERED)
+     */
+    FiboxAnswer* answer;
+
+    /**
+     * @brief The error message (set when FAILED)
+     */
+    String error;
+};
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "../types.h"
+#include <array>
+
+#define FIBOX_STATUS_BITS 32
+
+/**
+ * @brief Bits of the Fibox status word
+ */
+enum FiboxStatusBit : UInt
+{
+    FIBOX_STATUS_PT100_DISCONNECTED = 1U << 0,
+    FIBOX_STATUS_NO_SENSOR = 1U << 1,
+    FIBOX_STATUS_LOW_AMPLITUDE = 1U << 2,
+    FIBOX_STATUS_SD_CARD_FAILURE = 1U << 3,
+    FIBOX_STATUS_REFERENCE_AMPLITUDE = 1U << 4,
+    FIBOX_STATUS_PHOTODIODE_SATURATED = 1U << 5,
+    FIBOX_STATUS_ADC_OVERFLOW_REFERENCE = 1U << 6,
+    FIBOX_STATUS_ADC_OVERFLOW_SIGNAL = 1U << 7,
+    FIBOX_STATUS_ADC_OVERFLOW_SIGNAL_2 = 1U << 8,
+    FIBOX_STATUS_PME_ERROR = 1U << 9,
+    FIBOX_STATUS_PRESSURE_SENSOR_MISSING = 1U << 10,
+    FIBOX_STATUS_TEMPERATURE_TOO_HIGH = 1U << 11,
+    FIBOX_STATUS_SD_CARD_FULL = 1U << 12,
+    FIBOX_STATUS_PULSE_COUNTER_OVERFLOW = 1U << 13,
+    FIBOX_STATUS_TEMPERATURE_UNAVAILABLE = 1U << 14,
+    FIBOX_STATUS_PRESSURE_UNAVAILABLE = 1U << 15,
+    FIBOX_STATUS_DATE_NOT_SET = 1U << 16
+};
+
+/**
+* FiboxStatus - Typed Fibox status word
+* It keeps the raw 32-bits bitmask sent by the Fibox with a measurement, decoded with bit operations on demand
+*/
+struct FiboxStatus
+{
+    /**
+     * @brief The raw status bitmask (0 if the measurement is clean)
+     */
+    UInt bits;
+
+    /**
+     * @brief Returns if no status bit is set
+     *
+     * @return True if the status is clean
+     */
+    bool isClean() const
+    {
+        return bits == 0U;
+    }
+
+    /**
+     * @brief Returns if a status bit is set
+     *
+     * @param bit The bit (see FiboxStatusBit)
+     * @return True if set
+     */
+    bool has(UInt bit) const
+    {
+        return (bits & bit) != 0U;
+    }
+
+    /**
+     * @brief Get the human readable message of a status bit
+     *
+     * @param index The index of the bit (0 to FIBOX_STATUS_BITS - 1)
+     * @return The message
+     */
+    static const char* message(UInt index)
+    {
+        static const std::array<const char*, FIBOX_STATUS_BITS> MESSAGES = {
+            "Le capteur PT100 (température) du Fibox n'est pas connécté",
+            "Le capteur d'oxygène du Fibox n'est pas/mal détécté (embout en fibre optique et/ou pastille)",
+            "Le capteur d'oxygène du Fibox (pastille) est mal détécté car l'amplitude du signal de réponse est trop faible. Avez-vous bien mis l'embout en fibre optique et la pastille en face l'un de l'autre ? La pastille est peut-être trop éloigné",
+            "Défaillance de la carte SD",
+            "L'amplitude de référence est en dehors des limites",
+            "La photodiode est saturé. Le capteur est peut-être surexposé à la lumière",
+            "ADC overflow (Reference)",
+            "ADC overflow (Signal)",
+            "ADC overflow (Signal)",
+            "PME error",
+            "Le capteur de pression du Fibox n'a pas été détécté",
+            "La température est trop élevé",
+            "La carte SD est pleine",
+            "Débordement du compteur d'impulsions",
+            "Le capteur de température n'est pas disponible",
+            "Le capteur de pression n'est pas disponible",
+            "La date/heure n'est pas défini",
+            "Erreur inconnue", "Erreur inconnue", "Erreur inconnue", "Erreur inconnue", "Erreur inconnue",
+            "Erreur inconnue", "Erreur inconnue", "Erreur inconnue", "Erreur inconnue", "Erreur inconnue",
+            "Erreur inconnue", "Erreur inconnue", "Erreur inconnue", "Erreur inconnue", "Erreur inconnue"
+        };
+        return index < FIBOX_STATUS_BITS ? MESSAGES[index] : "Erreur inconnue";
+    }
+};
@@ -0,0 +1,36 @@
+#define _USE_MATH_DEFINES
+#include "fastmath.h"
+#include <cmath>
+
+double FastMath::tan(double x)
+{
+    if (x < 0 || x > M_PI_2) {
+        return std::tan(x);
+    }
+
+    return tanInRange(x);
+}
+
+double FastMath::exp(double x)
+{
+    // e^x = 2^n * e^g with |g| <= ln(2)/2
+    double n = std::nearbyint(x * M_LOG2E);
+    double g = x - n * M_LN2;
+    double p = 1.0 + g * (1.0 + g * (1.0 / 2.0 + g * (1.0 / 6.0 + g * (1.0 / 24.0 + g * (1.0 / 120.0 + g * (1.0 / 720.0 + g * (1.0 / 5040.0)))))));
+    return std::ldexp(p, (int)n);
+}
+
+double FastMath::log(double x)
+{
+    // ln(x) = e * ln(2) + ln(m) with m in [sqrt(2)/2, sqrt(2)], ln(m) = 2 * atanh((m - 1) / (m + 1))
+    int e;
+    double m = std::frexp(x, &e);
+    if (m < M_SQRT1_2) {
+        m *= 2.0;
+        e--;
+    }
+
+    double s = (m - 1.0) / (m + 1.0);
+    double s2 = s * s;
+    return e * M_LN2 + 2.0 * s * (1.0 + s2 * (1.0 / 3.0 + s2 * (1.0 / 5.0 + s2 * (1.0 / 7.0 + s2 * (1.0 / 9.0)))));
+}
@@ -0,0 +1,126 @@
+#ifndef FASTMATH_H
+#define FASTMATH_H
+
+#include <cstdint>
+#include <cstring>
+
+/**
+ * FastMath - Approximations of the transcendental functions used by the oxygen calculation
+ * They avoid the libm calls on the low-power boards. The maximum errors below have been measured
+ * against the libm over the physical input range (0-50 °C, 0-90° phase angle).
+ */
+class FastMath
+{
+public:
+    /**
+     * @brief Tangent of an angle between 0 and pi/2 (Padé approximant with reflection around pi/4)
+     * The maximum relative error is 1.4e-8. Outside of [0, pi/2], std::tan is used.
+     *
+     * @param x The angle in radians
+     * @return The tangent
+     */
+    static double tan(double x);
+
+    /**
+     * @brief Exponential (range reduction to [-ln(2)/2, ln(2)/2] and degree 7 polynomial)
+     * The maximum relative error is 7.1e-9.
+     *
+     * @param x The exponent
+     * @return e^x
+     */
+    static double exp(double x);
+
+    /**
+     * @brief Natural logarithm of a positive number (mantissa in [sqrt(2)/2, sqrt(2)] and atanh series)
+     * The maximum absolute error is 7.1e-10.
+     *
+     * @param x The positive number
+     * @return ln(x)
+     */
+    static double log(double x);
+
+    /*
+     * Branch-free variants for the batch loops: no libm call and only selects, so the compiler can vectorize them
+     * (the selects are only if-converted with -fno-trapping-math, see OXYGEN_CALCULATION_OPTIONS in CMakeLists.txt).
+     * On their domain, they return exactly the same values as tan(), exp() and log().
+     */
+
+    /**
+     * @brief Tangent of an angle in [0, pi/2] (no fallback outside of this range)
+     */
+    static inline double tanInRange(double x);
+
+    /**
+     * @brief Exponential of an exponent in [-708, 709] (the result and the power of two stay normal numbers)
+     */
+    static inline double expInRange(double x);
+
+    /**
+     * @brief Natural logarithm of a positive normal number
+     */
+    static inline double logInRange(double x);
+
+private:
+    static constexpr double PI_2 = 1.57079632679489661923;
+    static constexpr double PI_4 = 0.785398163397448309616;
+    static constexpr double LOG2E = 1.44269504088896340736;
+    static constexpr double LN2 = 0.693147180559945309417;
+    static constexpr double SQRT1_2 = 0.707106781186547524401;
+
+    static inline double fromBits(uint64_t bits)
+    {
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    static inline uint64_t toBits(double value)
+    {
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+};
+
+inline double FastMath::tanInRange(double x)
+{
+    // tan(x) = 1 / tan(pi/2 - x), so the approximant is only evaluated on [0, pi/4]
+    bool reflected = x > PI_4;
+    double y = reflected ? PI_2 - x : x;
+
+    double y2 = y * y;
+    double t = y * (945.0 + y2 * (-105.0 + y2)) / (945.0 + y2 * (-420.0 + 15.0 * y2));
+    return reflected ? 1.0 / t : t;
+}
+
+inline double FastMath::expInRange(double x)
+{
+    // e^x = 2^n * e^g with |g| <= ln(2)/2. Adding 1.5 * 2^52 rounds x * log2(e) to the nearest integer n
+    // (as nearbyint) and leaves n in the low bits of the sum, which gives 2^n without ldexp.
+    const double shift = 6755399441055744.0;
+    double shifted = x * LOG2E + shift;
+    double n = shifted - shift;
+    double g = x - n * LN2;
+    double p = 1.0 + g * (1.0 + g * (1.0 / 2.0 + g * (1.0 / 6.0 + g * (1.0 / 24.0 + g * (1.0 / 120.0 + g * (1.0 / 720.0 + g * (1.0 / 5040.0)))))));
+    return p * fromBits((toBits(shifted) - toBits(shift) + 1023) << 52);
+}
+
+inline double FastMath::logInRange(double x)
+{
+    // x = m * 2^e with m in [0.5, 1) (as frexp), read from the bits. The exponent is converted to a double
+    // with the 2^52 trick, since the vector units have no 64-bit integer conversion before AVX-512.
+    uint64_t bits = toBits(x);
+    double m = fromBits((bits & 0x000FFFFFFFFFFFFFull) | 0x3FE0000000000000ull);
+    double e = fromBits((bits >> 52) | 0x4330000000000000ull) - 4503599627370496.0 - 1022.0;
+
+    // ln(x) = e * ln(2) + ln(m) with m in [sqrt(2)/2, sqrt(2)], ln(m) = 2 * atanh((m - 1) / (m + 1))
+    bool low = m < SQRT1_2;
+    m = low ? m * 2.0 : m;
+    e = low ? e - 1.0 : e;
+
+    double s = (m - 1.0) / (m + 1.0);
+    double s2 = s * s;
+    return e * LN2 + 2.0 * s * (1.0 + s2 * (1.0 / 3.0 + s2 * (1.0 / 5.0 + s2 * (1.0 / 7.0 + s2 * (1.0 / 9.0)))));
+}
+
+#endif // FASTMATH_H
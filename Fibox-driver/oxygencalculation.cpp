@@ -1,131 +1,216 @@
 #define _USE_MATH_DEFINES
 #include "oxygencalculation.h"
+#include "fastmath.h"
 #include <cmath>
 #include <stdio.h>
 
 
-OxygenCalculation::OxygenCalculation(MeasureConfig* config)
+namespace {
+
+// The transcendental functions of each calculation mode
+struct ExactMath {
+    static double tan(double x) { return std::tan(x); }
+    static double exp(double x) { return std::exp(x); }
+    static double log(double x) { return std::log(x); }
+};
+
+struct ApproximatedMath {
+    static double tan(double x) { return FastMath::tan(x); }
+    static double exp(double x) { return FastMath::exp(x); }
+    static double log(double x) { return FastMath::log(x); }
+};
+
+// Same values as ApproximatedMath on the physical range, without branches (batch loops)
+struct BranchFreeMath {
+    static double tan(double x) { return FastMath::tanInRange(x); }
+    static double exp(double x) { return FastMath::expInRange(x); }
+    static double log(double x) { return FastMath::logInRange(x); }
+};
+
+template <typename Math>
+inline double tanPhi(double angle)
 {
-    
-    this->config = config;
-    this->mPhaseAngle = 12;
-    this->mPressure = 1013;
-    this->mTemperature = 20;
+    return Math::tan(angle * M_PI / 180.0);
 }
 
-void OxygenCalculation::setPressure(double valInPa)
+inline double phi0(const MeasureConfig& config, double temp)
 {
-    this->mPressure = valInPa / 100.0; // From Pa to hPa
+    return (config.derived.phi0Offset + config.DPHI1 * temp + config.DPHI2 * temp * temp) * (M_PI / 180.0);
 }
 
-void OxygenCalculation::setTemperature(double valInC)
+template <typename Math>
+inline double tanPhi0(const MeasureConfig& config, double temp)
 {
-    this->mTemperature = valInC;
+    return Math::tan(phi0(config, temp));
 }
 
-void OxygenCalculation::setPhaseAngle(double valInDegres)
+inline double ksvt(const MeasureConfig& config, double temp)
 {
-    this->mPhaseAngle = valInDegres;
+    return config.derived.ksvtOffset + config.DKSV1 * temp - config.DKSV2 * temp * temp;
+}
+
+template <typename Math>
+inline double pwT(double temperature)
+{
+    return Math::exp(52.57 - 6690.9 / temperature - 4.681 * Math::log(temperature));
 }
 
-double OxygenCalculation::convertOxygenValue(double val)
+/**
+ * @brief Compute the oxygen value of one sample (shared by the scalar and the batch paths)
+ * The calibration and measure modes are template parameters, so each variant has no branch.
+ *
+ * @param config The measure configuration
+ * @param phaseAngle The phase angle in degrees
+ * @param temperature The temperature in Celsius
+ * @param pressure The pressure in hPa
+ * @return The oxygen value
+ */
+template <typename Math, bool calibIsHumid, bool humidMode>
+inline double oxygenValue(const MeasureConfig& config, double phaseAngle, double temperature, double pressure)
 {
-    if (!config->humidMode)
+    double calPressure = config.pressure;
+    double invM = config.derived.invM;
+
+    // The water vapour pressure is only needed in humid mode or with a humid calibration
+    double pw = 0;
+    if (humidMode || calibIsHumid) {
+        pw = pwT<Math>(temperature + 273.15);
+    }
+
+    double ratio = tanPhi<Math>(phaseAngle) / tanPhi0<Math>(config, temperature);
+    double k = ksvt(config, temperature);
+
+    double num1 = ratio * invM * k * k;
+    double num2 = k * (ratio * (1.0 + invM) + config.F1 * (1.0 - invM) - 1.0);
+    double num3 = ratio - 1.0;
+    double num4 = (-num2 + std::sqrt(num2 * num2 - 4.0 * num1 * num3)) / (2.0 * num1);
+
+    double o2;
+    if (!calibIsHumid) {
+        if (!humidMode)
+        {
+            o2 = num4 * (calPressure / pressure);
+        }
+        else
+        {
+            o2 = num4 * calPressure / (calPressure - pw) * (calPressure / pressure);
+        }
+    } else {
+        if (!humidMode) {
+            o2 = num4 * ((calPressure - pw) / calPressure) * (calPressure / pressure);
+        } else {
+            o2 = num4 * (calPressure / pressure);
+        }
+    }
+
+    // Conversion to the output unit
+    if (!humidMode)
     {
-        return val * 0.2095;
+        return o2 * 0.2095;
     }
     else
     {
-        return (val * 0.2095 * ((mPressure - pwT(mTemperature + 273.15)) / mPressure));
+        return (o2 * 0.2095 * ((pressure - pw) / pressure));
     }
 }
 
-double OxygenCalculation::o2UnitCorrection()
+template <typename Math>
+double oxygenValue(const MeasureConfig& config, double phaseAngle, double temperature, double pressure)
 {
-    return config->o2Cal2nd;
+    if (!config.calibIsHumid) {
+        return config.humidMode ? oxygenValue<Math, false, true>(config, phaseAngle, temperature, pressure) : oxygenValue<Math, false, false>(config, phaseAngle, temperature, pressure);
+    }
+    return config.humidMode ? oxygenValue<Math, true, true>(config, phaseAngle, temperature, pressure) : oxygenValue<Math, true, false>(config, phaseAngle, temperature, pressure);
 }
 
-double OxygenCalculation::tanPhi(double angle)
+template <typename Math, bool calibIsHumid, bool humidMode>
+void computeLoop(const MeasureConfig& sharedConfig, const double* __restrict phaseAngles, const double* __restrict temperatures, const double* __restrict pressures, double* __restrict o2, size_t count)
 {
-    return std::tan(angle * M_PI / 180.0);
+    // Local copy, so the compiler knows that the output stores do not modify the configuration
+    const MeasureConfig config = sharedConfig;
+    for (size_t i = 0; i < count; i++) {
+        o2[i] = oxygenValue<Math, calibIsHumid, humidMode>(config, phaseAngles[i], temperatures[i], pressures[i] / 100.0); // From Pa to hPa
+    }
 }
 
-double OxygenCalculation::tanPhi0(double temp)
+template <typename Math>
+void computeLoop(const MeasureConfig& config, const double* __restrict phaseAngles, const double* __restrict temperatures, const double* __restrict pressures, double* __restrict o2, size_t count)
 {
-    return std::tan((config->cal0 + config->DPHI1 * (temp - config->t0) + config->DPHI2 * (std::pow(temp, 2.0) - std::pow(config->t0, 2.0))) * (M_PI / 180.0));
+    if (!config.calibIsHumid) {
+        if (config.humidMode) {
+            computeLoop<Math, false, true>(config, phaseAngles, temperatures, pressures, o2, count);
+        } else {
+            computeLoop<Math, false, false>(config, phaseAngles, temperatures, pressures, o2, count);
+        }
+    } else {
+        if (config.humidMode) {
+            computeLoop<Math, true, true>(config, phaseAngles, temperatures, pressures, o2, count);
+        } else {
+            computeLoop<Math, true, false>(config, phaseAngles, temperatures, pressures, o2, count);
+        }
+    }
 }
 
-double OxygenCalculation::B()
+/**
+ * @brief Checks that the branch-free tangent can be used (all the phase angles and phi0 in [0, pi/2])
+ */
+bool anglesInRange(const MeasureConfig& config, const double* phaseAngles, const double* temperatures, size_t count)
 {
-    double num1 = o2UnitCorrection();
-    double num2 = tanPhi(config->cal2nd) / tanPhi0(config->t2nd);
-    return num2 * num1 + num2 * (1.0 / config->M) * num1 - config->F1 * (1.0 / config->M) * num1 - num1 + config->F1 * num1;
+    bool inRange = true;
+    for (size_t i = 0; i < count; i++) {
+        double phase = phaseAngles[i] * M_PI / 180.0;
+        double phi0Angle = phi0(config, temperatures[i]);
+        inRange &= (phase >= 0) & (phase <= M_PI_2) & (phi0Angle >= 0) & (phi0Angle <= M_PI_2);
+    }
+    return inRange;
 }
 
-double OxygenCalculation::ksv()
-{
-    double num1 = tanPhi(config->cal2nd) / tanPhi0(config->t2nd) * (1.0 / config->M) * std::pow(o2UnitCorrection(), 2.0);
-    double x = B();
-    double num2 = tanPhi(config->cal2nd) / tanPhi0(config->t2nd) - 1.0;
-    return (-x + std::sqrt(std::pow(x, 2.0) - 4.0 * num1 * num2)) / (2.0 * num1);
 }
 
-double OxygenCalculation::ksvt()
+OxygenCalculation::OxygenCalculation(const MeasureConfig* config)
 {
-    return ksv() - config->DKSV1 * (config->t2nd - mTemperature) + config->DKSV2 * (std::pow(config->t2nd, 2.0) - std::pow(mTemperature, 2.0));
+    
+    this->config = config;
+    this->mPhaseAngle = 12;
+    this->mPressure = 1013;
+    this->mTemperature = 20;
 }
 
-double OxygenCalculation::a()
+void OxygenCalculation::setConfig(const MeasureConfig* config)
 {
-    double num1 = tanPhi(mPhaseAngle) / tanPhi0(mTemperature);
-    double num2 = ksvt();
-    double num3 = 1.0 / config->M;
-    return num1 * num3 * std::pow(num2, 2.0);
+    this->config = config;
 }
 
-double OxygenCalculation::b()
+void OxygenCalculation::setPressure(double valInPa)
 {
-    double num = tanPhi(mPhaseAngle) / tanPhi0(mTemperature);
-    return num * ksvt() + num * (1.0 / config->M) * ksvt() - config->F1 * (1.0 / config->M) * ksvt() - ksvt() + config->F1 * ksvt();
+    this->mPressure = valInPa / 100.0; // From Pa to hPa
 }
 
-double OxygenCalculation::c()
+void OxygenCalculation::setTemperature(double valInC)
 {
-    return tanPhi(mPhaseAngle) / tanPhi0(mTemperature) - 1.0;
+    this->mTemperature = valInC;
 }
 
-double OxygenCalculation::pwT(double temperature)
+void OxygenCalculation::setPhaseAngle(double valInDegres)
 {
-    return std::exp(52.57 - 6690.9 / temperature - 4.681 * std::log(temperature));
+    this->mPhaseAngle = valInDegres;
 }
 
-double OxygenCalculation::basicOxyCalculation()
+double OxygenCalculation::getOxygenValue()
 {
-    double temperature = mTemperature;
-    double pressure = config->pressure;
-    double num1 = a();
-    double num2 = b();
-    double num3 = c();
-    double num4 = (-num2 + std::sqrt(std::pow(num2, 2.0) - 4.0 * num1 * num3)) / (2.0 * num1);
-    if (!config->calibIsHumid) {
-        if (!config->humidMode)
-        {
-            return num4 * (pressure / mPressure);
-        }
-        else
-        {
-            return num4 * pressure / (pressure - pwT(temperature + 273.15)) * (pressure / mPressure);
-        }
-    } else {
-        if (!config->humidMode) {
-            return num4 * ((pressure - pwT(temperature + 273.15)) / pressure) * (pressure / mPressure);
-        } else {
-            return num4 * (pressure / mPressure);
-        }
+    if (config->fastMath) {
+        return oxygenValue<ApproximatedMath>(*config, mPhaseAngle, mTemperature, mPressure);
     }
+    return oxygenValue<ExactMath>(*config, mPhaseAngle, mTemperature, mPressure);
 }
 
-double OxygenCalculation::getOxygenValue()
+void OxygenCalculation::computeBatch(const MeasureConfig& config, const double* __restrict phaseAngles, const double* __restrict temperatures, const double* __restrict pressures, double* __restrict o2, size_t count)
 {
-    return convertOxygenValue(basicOxyCalculation());
+    if (!config.fastMath) {
+        computeLoop<ExactMath>(config, phaseAngles, temperatures, pressures, o2, count);
+    } else if (anglesInRange(config, phaseAngles, temperatures, count)) {
+        computeLoop<BranchFreeMath>(config, phaseAngles, temperatures, pressures, o2, count);
+    } else {
+        computeLoop<ApproximatedMath>(config, phaseAngles, temperatures, pressures, o2, count);
+    }
 }
@@ -2,6 +2,7 @@
 #define OXYGENCALCULATION_H
 
 #include "../MeasureConfig.h"
+#include <cstddef>
 
 /**
  * OxygenCalculation - Oxygen calculation class
@@ -10,20 +11,7 @@
 class OxygenCalculation
 {
 private:
-    double o2UnitCorrection();
-    double convertOxygenValue(double val);
-    double tanPhi(double angle);
-    double tanPhi0(double temp);
-    double B();
-    double ksv();
-    double ksvt();
-    double a();
-    double b();
-    double c();
-    double pwT(double temperature);
-    double basicOxyCalculation();
-
-    MeasureConfig* config;
+    const MeasureConfig* config;
 
     // measurement data
     double mPressure;
@@ -36,7 +24,14 @@ public:
      *
      * @param config The measure configuration pointer
      */
-    OxygenCalculation(MeasureConfig* config);
+    OxygenCalculation(const MeasureConfig* config);
+
+    /**
+     * @brief Set the measure configuration used by the next calculations
+     *
+     * @param config The measure configuration pointer
+     */
+    void setConfig(const MeasureConfig* config);
 
     /**
      * @brief Set the pressure value in Pascal
@@ -59,6 +54,24 @@ public:
      */
     void setPhaseAngle(double valInDegres);
     double getOxygenValue();
+
+    /**
+     * @brief Compute the oxygen values of many samples stored as separate arrays (structure of arrays)
+     * It does not use the state of any OxygenCalculation object, so a stored set of raw samples can be
+     * recomputed with another configuration. The results match the scalar path (checked by tests/oxygencalculation_bench).
+     * The configuration branches are resolved once, before the loop. In fast-math mode (with phase angles
+     * between 0 and 90°), the loop body is branch-free and without libm calls, so the compiler vectorizes it
+     * (NEON on AArch64, SSE2/AVX on x86, with -O3 -fno-math-errno -fno-trapping-math).
+     * The exact mode calls the libm tan/exp/log for each sample and stays scalar.
+     *
+     * @param config The measure configuration
+     * @param phaseAngles The phase angles in degrees
+     * @param temperatures The temperatures in Celsius
+     * @param pressures The pressures in Pascal
+     * @param o2 The output array receiving the oxygen values
+     * @param count The number of samples
+     */
+    static void computeBatch(const MeasureConfig& config, const double* phaseAngles, const double* temperatures, const double* pressures, double* o2, size_t count);
 };
 
 #endif // OXYGENCALCULATION_H
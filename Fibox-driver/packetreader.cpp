@@ -32,7 +32,7 @@ FiboxAnswer* PacketReader::processMessage(const BytesArray& buffer)
         BytesArray buf = buffer;
         buf.erase(buf.begin(), buf.begin() + 2); // remove 2 first bytes
         if (processReceivedData(buf)) { // true on new data
-            return new FiboxAnswer(temperature, pressure, phase, errors);
+            return new FiboxAnswer(temperature, pressure, phase, status);
         }
     }
 
@@ -43,7 +43,7 @@ void PacketReader::reset()
 {
     this->packageCounter = 0;
     this->deviceResponse = -1;
-    this->errors.clear();
+    this->status = FiboxStatus{ 0U };
     this->temperature = 0;
     this->pressure = 0;
     this->phase = 0;
@@ -74,55 +74,6 @@ bool PacketReader::processReceivedFooter(const BytesArray& buffer)
     return false; // no new o2 data
 }
 
-std::map<UInt, String> PacketReader::MeasurementErrorDict = {
-    {1U, "Le capteur PT100 (température) du Fibox n'est pas connécté"},
-    {2U, "Le capteur d'oxygène du Fibox n'est pas/mal détécté (embout en fibre optique et/ou pastille)"},
-    {4U, "Le capteur d'oxygène du Fibox (pastille) est mal détécté car l'amplitude du signal de réponse est trop faible. Avez-vous bien mis l'embout en fibre optique et la pastille en face l'un de l'autre ? La pastille est peut-être trop éloigné"},
-    {8U, "Défaillance de la carte SD"},
-    {16U, "L'amplitude de référence est en dehors des limites"},
-    {32U, "La photodiode est saturé. Le capteur est peut-être surexposé à la lumière"},
-    {64U, "ADC overflow (Reference)"},
-    {128U, "ADC overflow (Signal)"},
-    {256U, "ADC overflow (Signal)"},
-    {512U, "PME error"},
-    {1024U, "Le capteur de pression du Fibox n'a pas été détécté"},
-    {2048U, "La température est trop élevé"},
-    {4096U, "La carte SD est pleine"},
-    {8192U, "Débordement du compteur d'impulsions"},
-    {16384U, "Le capteur de température n'est pas disponible"},
-    {32768U, "Le capteur de pression n'est pas disponible"},
-    {65536U, "La date/heure n'est pas défini"},
-    {131072U, "Erreur inconnue"},
-    {262144U, "Erreur inconnue"},
-    {524288U, "Erreur inconnue"},
-    {1048576U, "Erreur inconnue"},
-    {2097152U, "Erreur inconnue"},
-    {4194304U, "Erreur inconnue"},
-    {8388608U, "Erreur inconnue"},
-    {16777216U, "Erreur inconnue"},
-    {33554432U, "Erreur inconnue"},
-    {67108864U, "Erreur inconnue"},
-    {134217728U, "Erreur inconnue"},
-    {268435456U, "Erreur inconnue"},
-    {536870912U, "Erreur inconnue"},
-    {1073741820U, "Erreur inconnue"},
-    {2147483650U, "Erreur inconnue"}
-};
-
-std::map<UInt, String> PacketReader::getMeasurementErrors(UInt error) {
-    if (error == 0U)
-        return {};
-    std::map<UInt, String> measurementErrors;
-    double num = static_cast<double>(error);
-    for (const auto& pair : MeasurementErrorDict) {
-        if (num - static_cast<double>(pair.first) >= 0.0) {
-            measurementErrors.insert(std::pair<UInt, String>(pair.first, pair.second));
-            num -= static_cast<double>(pair.first);
-        }
-    }
-    return measurementErrors;
-}
-
 double PacketReader::toDouble(const BytesArray& buffer) {
     double value = 0.0;
     if (buffer.size() != sizeof(double)) {
@@ -166,7 +117,7 @@ bool PacketReader::processMeasurement(const BytesArray& buffer)
             break;
 
         case 6:
-            errors = getMeasurementErrors(toUInt32(buffer));
+            status = FiboxStatus{ toUInt32(buffer) };
             return true; // new data arrived [!]
 
         default:
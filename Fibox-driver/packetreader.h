@@ -2,7 +2,6 @@
 #define PACKETREADER_H
 
 #include "oxygencalculation.h"
-#include <map>
 #include "../types.h"
 #include "FiboxAnswer.h"
 #include <mutex>
@@ -62,20 +61,7 @@ private:
     double phase;
     double temperature;
     double pressure;
-    std::map<UInt, String> errors;
-
-    /**
-     * @brief The measurement error dictionary
-     */
-    static std::map<UInt, String> MeasurementErrorDict;
-
-    /**
-     * @brief Process the UInt error code to a list of human readable error message
-     *
-     * @param error The error code
-     * @return The list of human readable error message
-     */
-    std::map<UInt, String> getMeasurementErrors(UInt error);
+    FiboxStatus status;
 
     // Helpers funcs
     double toDouble(const BytesArray& buffer);
@@ -1,25 +1,15 @@
 #include "packetwriter.h"
 #include "../types.h"
+#include <algorithm>
 
 PacketWriter::PacketWriter(String devId) {
     this->requestId = 0;
-    this->deviceId = toBytes((UInt)stoi(devId.substr(4)));
-}
-
-BytesArray PacketWriter::toBytes(UInt value, bool twoBytesMode) {
-    UInt a = value & 0xFF;
-    UInt b = (value >> 8) & 0xFF;
 
-    if (twoBytesMode) {
-        BytesArray res{(Byte)a ,(Byte)b};
-        return res;
-    }
+    // Bytes order expected by the Fibox: 4th byte first, then the 3 first ones
+    UInt value = (UInt)stoi(devId.substr(4));
+    this->deviceId = { (Byte)((value >> 24) & 0xFF), (Byte)(value & 0xFF), (Byte)((value >> 8) & 0xFF), (Byte)((value >> 16) & 0xFF) };
 
-    UInt c = (value >> 16) & 0xFF;
-    UInt d = (value >> 24) & 0xFF;
-
-    BytesArray res{(Byte)d ,(Byte)a ,(Byte)b ,(Byte)c};
-    return res;
+    this->getMeasureHeader = withDeviceId(GET_MEASURE_REQUEST_HEADER);
 }
 
 UShort PacketWriter::getRequestId() const
@@ -40,63 +30,31 @@ UShort PacketWriter::generateRequestId()
     }
 }
 
-BytesArray PacketWriter::prepareGetMeasureRequestHeader(UShort id)
+RequestHeader PacketWriter::withDeviceId(const RequestHeader& header) const
 {
-    BytesArray packet;
-
-    // Send message type code (request header = FF 01 01)
-    packet.push_back((Byte)255);
-    packet.push_back((Byte)1);
-    packet.push_back((Byte)1);
-
-    // Send a part of the device ID
-    for (size_t i = 0; i < deviceId.size(); i++) {
-        packet.push_back(deviceId[i]);
-    }
-
-    // Send the static 32-bits channel address (00 01 00 00 00 ... 00)
-    for (int i = 0; i <= 32; i++) {
-        int val = 0;
-        if (i == 1) {
-            val = 1;
-        }
-
-        packet.push_back((Byte)val);
-    }
-
-    // Send the request type code for get measure action (10 00)
-    packet.push_back((Byte)16);
-    packet.push_back((Byte)0);
+    RequestHeader res = header;
+    std::copy(deviceId.begin(), deviceId.end(), res.begin() + DEVICE_ID_OFFSET);
+    return res;
+}
 
-    // Send the request id
-    BytesArray id_packet = toBytes(id, true);
-    packet.push_back((Byte)id_packet[0]);
-    packet.push_back((Byte)id_packet[1]);
+size_t PacketWriter::writeRequest(const RequestHeader& header, UShort id, Byte* buffer)
+{
+    std::copy(header.begin(), header.end(), buffer);
+    buffer[HEADER_REQUEST_ID_OFFSET] = (Byte)(id & 0xFF);
+    buffer[HEADER_REQUEST_ID_OFFSET + 1] = (Byte)((id >> 8) & 0xFF);
 
-    // Fill the rest will 0
-    packet.push_back((Byte)0);
-    packet.push_back((Byte)0);
-    packet.push_back((Byte)0);
-    packet.push_back((Byte)0);
+    Byte* footer = buffer + REQUEST_HEADER_SIZE;
+    std::copy(REQUEST_FOOTER.begin(), REQUEST_FOOTER.end(), footer);
+    footer[FOOTER_REQUEST_ID_OFFSET] = (Byte)(id & 0xFF);
+    footer[FOOTER_REQUEST_ID_OFFSET + 1] = (Byte)((id >> 8) & 0xFF);
 
     // generate an other request id for other requests
     this->generateRequestId();
 
-    return packet;
+    return REQUEST_HEADER_SIZE + REQUEST_FOOTER_SIZE;
 }
 
-BytesArray PacketWriter::prepareGetMeasureRequestFooter(UShort id)
+size_t PacketWriter::writeGetMeasureRequest(UShort id, Byte* buffer)
 {
-    BytesArray packet;
-
-    // Send message type code (request footer = FF 02)
-    packet.push_back((Byte)255);
-    packet.push_back((Byte)2);
-
-    // Send the request id
-    BytesArray id_packet = toBytes(id, true);
-    packet.push_back((Byte)id_packet[0]);
-    packet.push_back((Byte)id_packet[1]);
-
-    return packet;
+    return writeRequest(getMeasureHeader, id, buffer);
 }
@@ -2,18 +2,83 @@
 #define PACKETWRITER_H
 
 #include "../types.h"
+#include <array>
+#include <cstddef>
+
+#define REQUEST_HEADER_SIZE 48          // Size of a request header packet
+#define REQUEST_FOOTER_SIZE 4           // Size of a request footer packet
+#define DEVICE_ID_OFFSET 3              // Position of the device ID in the request header
+#define HEADER_REQUEST_ID_OFFSET 42     // Position of the request ID in the request header
+#define FOOTER_REQUEST_ID_OFFSET 2      // Position of the request ID in the request footer
+
+#define GET_MEASURE_REQUEST_TYPE 0x0010 // Request type code of the get measure action
+
+/**
+ * @brief A request header packet
+ */
+typedef std::array<Byte, REQUEST_HEADER_SIZE> RequestHeader;
+
+/**
+ * @brief A request footer packet
+ */
+typedef std::array<Byte, REQUEST_FOOTER_SIZE> RequestFooter;
+
+/**
+ * @brief Build the template of a request header for a request type
+ * The device ID and the request ID are left to 0, they are patched by the PacketWriter.
+ *
+ * @param requestType The request type code (see GET_MEASURE_REQUEST_TYPE)
+ * @return The request header template
+ */
+constexpr RequestHeader makeRequestHeader(UShort requestType)
+{
+    RequestHeader packet{};
+
+    // Message type code (request header = FF 01 01)
+    packet[0] = 0xFF;
+    packet[1] = 0x01;
+    packet[2] = 0x01;
+
+    // Bytes 3 to 6: a part of the device ID
+
+    // The static 32-bits channel address (00 01 00 00 00 ... 00), 33 bytes
+    packet[DEVICE_ID_OFFSET + 4 + 1] = 0x01;
+
+    // The request type code (little endian)
+    packet[HEADER_REQUEST_ID_OFFSET - 2] = (Byte)(requestType & 0xFF);
+    packet[HEADER_REQUEST_ID_OFFSET - 1] = (Byte)((requestType >> 8) & 0xFF);
+
+    // Bytes 42 and 43: the request ID, then 4 bytes at 0
+    return packet;
+}
+
+/**
+ * @brief Template of the get measure request header
+ */
+constexpr RequestHeader GET_MEASURE_REQUEST_HEADER = makeRequestHeader(GET_MEASURE_REQUEST_TYPE);
+
+/**
+ * @brief Template of the request footer (FF 02 followed by the request ID), common to all the requests
+ */
+constexpr RequestFooter REQUEST_FOOTER = { 0xFF, 0x02, 0x00, 0x00 };
 
 /**
  * PacketWriter - Fibox driver packet writer class
  * It implements the methods to prepare packets data to be sent to the Fibox device
+ * Packets are written from the templates above into a caller buffer, without any allocation.
  */
 class PacketWriter
 {
 private:
     /**
-    * @brief The Fibox device ID
+    * @brief The Fibox device ID bytes, as written in the request headers
+    */
+    std::array<Byte, 4> deviceId;
+
+    /**
+    * @brief The get measure request header, with the device ID already patched
     */
-    BytesArray deviceId;
+    RequestHeader getMeasureHeader;
 
     /**
     * @brief The current request ID
@@ -28,19 +93,10 @@ private:
     */
     UShort generateRequestId();
 
-    /**
-    * @brief Convert a UInt value to a BytesArray
-    *
-    * @param value The UInt value to convert
-    * @param twoBytesMode If true, the UInt value is converted to a two bytes array
-    * @return The BytesArray
-    */
-    BytesArray toBytes(UInt value, bool twoBytesMode = false);
-
 public:
     /**
     * @brief Construct a new Packet Writer object
-    * It also prepare the device ID bytes array from the device ID string given as parameter
+    * It also prepare the device ID bytes from the device ID string given as parameter and patches the request templates with it
     *
     * @param devId The Fibox device ID string
     */
@@ -49,20 +105,34 @@ public:
     UShort getRequestId() const;
 
     /**
-    * @brief Prepare a measurement request header package
+    * @brief Patch a request header template with the device ID
+    * To be called once per request type (e.g. at construction), the result can then be given to writeRequest for each send.
+    *
+    * @param header The request header template (see makeRequestHeader)
+    * @return The request header with the device ID
+    */
+    RequestHeader withDeviceId(const RequestHeader& header) const;
+
+    /**
+    * @brief Write a request (header followed by its footer) with the given request ID into a buffer
+    * The buffer must be at least REQUEST_HEADER_SIZE + REQUEST_FOOTER_SIZE bytes long.
+    * A new request ID is generated for the next requests.
     *
+    * @param header The request header, with the device ID (see withDeviceId)
     * @param id The request ID
-    * @return The BytesArray
+    * @param buffer The destination buffer
+    * @return The number of bytes written
     */
-    BytesArray prepareGetMeasureRequestHeader(UShort id);
+    size_t writeRequest(const RequestHeader& header, UShort id, Byte* buffer);
 
     /**
-    * @brief Prepare a measurement request footer package
+    * @brief Write a measurement request (header followed by its footer) into a buffer
     *
     * @param id The request ID
-    * @return The BytesArray
+    * @param buffer The destination buffer (REQUEST_HEADER_SIZE + REQUEST_FOOTER_SIZE bytes at least)
+    * @return The number of bytes written
     */
-    BytesArray prepareGetMeasureRequestFooter(UShort id);
+    size_t writeGetMeasureRequest(UShort id, Byte* buffer);
 
 };
 
@@ -1,7 +1,11 @@
+#define _USE_MATH_DEFINES
 #include "MeasureConfig.h"
+#include <cmath>
 
 MeasureConfig::MeasureConfig()
 {
+	fastMath = false;
+	version = 0;
 	set(237, 0.808, 30, -0.068, -0.00035, 0.000371, 0, 967, 60.22, 26.82, 20, 20, 100, true, false, false);
 }
 
@@ -23,4 +27,22 @@ void MeasureConfig::set(int altitude, double F1, double M, double DPHI1, double
 	this->calibIsHumid = calibIsHumid;
 	this->enableTempFibox = enableTempFibox;
 	this->humidMode = humidMode;
+
+	computeDerived();
+}
+
+void MeasureConfig::computeDerived()
+{
+	derived.invM = 1.0 / M;
+	derived.phi0Offset = cal0 - DPHI1 * t0 - DPHI2 * t0 * t0;
+
+	// Ratio between the calibration phase angle and the phase angle without oxygen, both at t2nd
+	double tanPhi0Cal2nd = std::tan((derived.phi0Offset + DPHI1 * t2nd + DPHI2 * t2nd * t2nd) * (M_PI / 180.0));
+	double ratio = std::tan(cal2nd * M_PI / 180.0) / tanPhi0Cal2nd;
+
+	double a = ratio * derived.invM * o2Cal2nd * o2Cal2nd;
+	double b = o2Cal2nd * (ratio * (1.0 + derived.invM) + F1 * (1.0 - derived.invM) - 1.0);
+	double c = ratio - 1.0;
+	derived.ksv = (-b + std::sqrt(b * b - 4.0 * a * c)) / (2.0 * a);
+	derived.ksvtOffset = derived.ksv - DKSV1 * t2nd + DKSV2 * t2nd * t2nd;
 }
@@ -1,9 +1,11 @@
 #pragma once
+#include "types.h"
 
 /**
  * @brief The MeasureConfig class
  * This class is used to store the configuration used to recalculate and correct measurements.
  * The configuration is set by the user by the SET_CONFIG command.
+ * Once published to the measure module, a configuration is an immutable profile: a change creates a new version.
  */
 class MeasureConfig
 {
@@ -30,6 +32,28 @@ public:
     bool enableTempFibox;
     bool humidMode;
 
+    /**
+     * @brief True to use the approximated transcendental functions (see FastMath) in the oxygen calculation.
+     * The oxygen values differ from the exact path by less than 1e-7 in relative terms (checked by tests/oxygencalculation_bench).
+     * It is not part of the calibration, so set() does not change it.
+     */
+    bool fastMath;
+
+    /**
+     * @brief The version of the profile (unique for each published configuration, 0 if not published).
+     */
+    UInt version;
+
+    /**
+     * @brief Terms depending only on the configuration, computed by set() instead of for each sample
+     */
+    struct Derived {
+        double invM;       // 1 / M
+        double phi0Offset; // cal0 - DPHI1 * t0 - DPHI2 * t0^2 (degrees)
+        double ksv;        // Stern-Volmer constant at the calibration temperature (t2nd)
+        double ksvtOffset; // ksv - DKSV1 * t2nd + DKSV2 * t2nd^2
+    } derived;
+
     MeasureConfig();
 
     /**
@@ -53,5 +77,11 @@ public:
     * @param humidMode The humidMode constant (true if measurements are realised in humid environment).
     */
     void set(int altitude, double F1, double M, double DPHI1, double DPHI2, double DKSV1, double DKSV2, double pressure, double cal0, double cal2nd, double t0, double t2nd, double o2Cal2nd, bool calibIsHumid, bool enableTempFibox, bool humidMode);
+
+private:
+    /**
+    * @brief Computes the derived terms from the calibration data and the constants.
+    */
+    void computeDerived();
 };
 
@@ -0,0 +1,146 @@
+#include "BinaryFrame.h"
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+#include <stdint.h>
+
+template <typename T>
+void BinaryFrame::write(String& frame, T value)
+{
+	// little-endian, whatever the host byte order
+	Byte bytes[sizeof(T)];
+	uint64_t raw = 0;
+	memcpy(&raw, &value, sizeof(T));
+	for (size_t i = 0; i < sizeof(T); i++) {
+		bytes[i] = (Byte)(raw >> (8 * i));
+	}
+	frame.append((const char*)bytes, sizeof(T));
+}
+
+void BinaryFrame::writeHeader(String& frame, Type type)
+{
+	frame.push_back(BINARY_FRAME_MAGIC_0);
+	frame.push_back(BINARY_FRAME_MAGIC_1);
+	frame.push_back((char)BINARY_FRAME_VERSION);
+	frame.push_back((char)type);
+	write<uint32_t>(frame, 0); // payload length, set when the frame is complete
+}
+
+void BinaryFrame::writeValue(String& frame, float value, bool doublePrecision)
+{
+	if (value == __FLT_MIN__) {
+		value = NAN;
+	}
+
+	if (doublePrecision) {
+		write<double>(frame, value);
+	} else {
+		write<float>(frame, value);
+	}
+}
+
+String BinaryFrame::encodeText(const String& json)
+{
+	String frame;
+	frame.reserve(BINARY_FRAME_HEADER_SIZE + json.size());
+	encodeText(frame, json);
+	return frame;
+}
+
+void BinaryFrame::encodeText(String& frame, const String& json)
+{
+	frame.clear();
+	writeHeader(frame, TEXT);
+	frame += json;
+	writeLength(frame);
+}
+
+String BinaryFrame::encodeMeasure(const String& id, SensorMeasure* measure, UInt channelMask, bool doublePrecision)
+{
+	String frame;
+	frame.reserve(64);
+	encodeMeasure(frame, id, measure, channelMask, doublePrecision);
+	return frame;
+}
+
+void BinaryFrame::encodeMeasure(String& frame, const String& id, SensorMeasure* measure, UInt channelMask, bool doublePrecision)
+{
+	frame.clear();
+	writeHeader(frame, MEASURE);
+	writeMeasure(frame, id, measure, channelMask, doublePrecision);
+	writeLength(frame);
+}
+
+void BinaryFrame::encodeMeasureHead(String& frame, const String& encoded, string_view id)
+{
+	size_t idSize = min(id.size(), (size_t)255);
+	frame.assign(encoded, 0, BINARY_FRAME_MEASURE_ID_OFFSET);
+	frame.push_back((char)idSize);
+	frame.append(id.data(), idSize);
+
+	// payload length of the whole frame
+	String length;
+	write<uint32_t>(length, encoded.size() + idSize - BINARY_FRAME_HEADER_SIZE);
+	frame.replace(4, 4, length);
+}
+
+String BinaryFrame::encodeSnapshot(UInt sequence, SensorMeasure* measure)
+{
+	String frame;
+	frame.reserve(64);
+	writeHeader(frame, SNAPSHOT);
+	write<uint32_t>(frame, sequence);
+	writeMeasure(frame, "", measure, (1U << SensorMeasure::CHANNEL_COUNT) - 1, false);
+	writeLength(frame);
+	return frame;
+}
+
+void BinaryFrame::writeLength(String& frame)
+{
+	String length;
+	write<uint32_t>(length, frame.size() - BINARY_FRAME_HEADER_SIZE);
+	frame.replace(4, 4, length);
+}
+
+void BinaryFrame::writeMeasure(String& frame, const String& id, SensorMeasure* measure, UInt channelMask, bool doublePrecision)
+{
+	int64_t timestamp = chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch()).count();
+	frame.push_back((char)(doublePrecision ? sizeof(double) : sizeof(float)));
+	write<int64_t>(frame, timestamp);
+	frame.push_back((char)min(id.size(), (size_t)255));
+	frame.append(id, 0, 255);
+
+	Byte validMask = 0;
+	for (UInt channel = 0; channel < SensorMeasure::CHANNEL_COUNT; channel++) {
+		if (channel != SensorMeasure::O2_PROBES && measure->getValue((SensorMeasure::Channel)channel) != __FLT_MIN__) {
+			validMask |= 1U << channel;
+		}
+	}
+	validMask |= measure->getO2ProbesValues().empty() ? 0 : 1U << SensorMeasure::O2_PROBES;
+
+	frame.push_back((char)channelMask);
+	frame.push_back((char)(validMask & channelMask));
+
+	for (UInt channel = 0; channel < SensorMeasure::CHANNEL_COUNT; channel++) {
+		if (!(channelMask & (1U << channel))) {
+			continue;
+		}
+
+		if (channel == SensorMeasure::O2_PROBES) {
+			const map<String, float>& probes = measure->getO2ProbesValues();
+			frame.push_back((char)min(probes.size(), (size_t)255));
+			size_t count = 0;
+			for (const auto& pair : probes) {
+				if (count++ == 255) {
+					break;
+				}
+				frame.push_back((char)min(pair.first.size(), (size_t)255));
+				frame.append(pair.first, 0, 255);
+				writeValue(frame, pair.second, doublePrecision);
+			}
+		} else {
+			writeValue(frame, measure->getValue((SensorMeasure::Channel)channel), doublePrecision);
+		}
+	}
+}
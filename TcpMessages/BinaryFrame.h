@@ -0,0 +1,99 @@
+#pragma once
+
+#include "../types.h"
+#include "../sensormeasure.h"
+#include <string_view>
+using namespace std;
+
+#define BINARY_FRAME_MAGIC_0 'F'
+#define BINARY_FRAME_MAGIC_1 'B'
+#define BINARY_FRAME_VERSION 1
+#define BINARY_FRAME_HEADER_SIZE 8
+
+// Offset of the request id length in a MEASURE frame (header, value size, timestamp)
+#define BINARY_FRAME_MEASURE_ID_OFFSET (BINARY_FRAME_HEADER_SIZE + 1 + 8)
+
+/**
+ * @brief Binary frame builder class (compact protocol selected with SET_PROTOCOL).
+ *
+ * All the integers and floats are little-endian.
+ * Header (8 bytes): 'F' 'B', version (uint8), type (uint8), payload length (uint32).
+ * Payload of a TEXT frame: the JSON answer.
+ * Payload of a MEASURE frame:
+ * - value size (uint8: 4 for float32, 8 for float64)
+ * - timestamp (int64, milliseconds since epoch)
+ * - request id length (uint8) and request id
+ * - channels mask (uint8, bit index: SensorMeasure::Channel) and valid mask (uint8, bit set if the value is available)
+ * - the value of each channel of the mask, in the bit order. An unavailable value is NaN.
+ *   O2_PROBES is a count (uint8) then, for each probe, the serial number length (uint8), the serial number and the value.
+ * Payload of a SNAPSHOT frame (UDP multicast): the sequence number (uint32) then a MEASURE payload with an empty request id.
+ */
+class BinaryFrame
+{
+public:
+	enum Type : Byte {
+		TEXT = 0,
+		MEASURE = 1,
+		SNAPSHOT = 2
+	};
+
+	/**
+	 * Builds a frame carrying a JSON answer
+	 * @param json The JSON answer
+	 * @return The frame
+	 */
+	static String encodeText(const String& json);
+
+	/**
+	 * Builds a frame carrying a JSON answer into a buffer (replacing its content, without reallocating it if it is large enough)
+	 * @param frame The frame
+	 * @param json The JSON answer
+	 */
+	static void encodeText(String& frame, const String& json);
+
+	/**
+	 * Builds a frame carrying measurements
+	 * @param id The request id
+	 * @param measure The measure
+	 * @param channelMask The measures to send (bit index: SensorMeasure::Channel)
+	 * @param doublePrecision True to send float64 values, false for float32
+	 * @return The frame
+	 */
+	static String encodeMeasure(const String& id, SensorMeasure* measure, UInt channelMask, bool doublePrecision);
+
+	/**
+	 * Builds a frame carrying measurements into a buffer (replacing its content, without reallocating it if it is large enough)
+	 * @param frame The frame
+	 * @param id The request id
+	 * @param measure The measure
+	 * @param channelMask The measures to send (bit index: SensorMeasure::Channel)
+	 * @param doublePrecision True to send float64 values, false for float32
+	 */
+	static void encodeMeasure(String& frame, const String& id, SensorMeasure* measure, UInt channelMask, bool doublePrecision);
+
+	/**
+	 * Builds the start of a MEASURE frame for a request id from a MEASURE frame encoded with an empty id
+	 * (the frame is this start followed by the encoded frame from BINARY_FRAME_MEASURE_ID_OFFSET + 1)
+	 * @param frame The start of the frame
+	 * @param encoded The MEASURE frame encoded with an empty id
+	 * @param id The request id
+	 */
+	static void encodeMeasureHead(String& frame, const String& encoded, string_view id);
+
+	/**
+	 * Builds a frame carrying a numbered snapshot of all the measurements (float32 values)
+	 * @param sequence The sequence number of the snapshot
+	 * @param measure The measure
+	 * @return The frame
+	 */
+	static String encodeSnapshot(UInt sequence, SensorMeasure* measure);
+
+private:
+	static void writeMeasure(String& frame, const String& id, SensorMeasure* measure, UInt channelMask, bool doublePrecision);
+	static void writeLength(String& frame);
+	static void writeHeader(String& frame, Type type);
+	static void writeValue(String& frame, float value, bool doublePrecision);
+
+	template <typename T>
+	static void write(String& frame, T value);
+};
@@ -1,4 +1,9 @@
 #include "TcpAnswer.h"
+#include "../jobmanager.h"
+#include "../measuremodule.h"
+#include <ctime>
+#include <algorithm>
+#include <cstdio>
 
 TcpAnswer::TcpAnswer(String id)
 {
@@ -6,25 +11,134 @@ TcpAnswer::TcpAnswer(String id)
 	this->success = true;
 	this->data = "";
 	this->errorCode = 0;
+	this->measure = nullptr;
+	this->deferred = false;
+}
+
+TcpAnswer::~TcpAnswer()
+{
+	delete this->measure;
+}
+
+void TcpAnswer::reset(string_view id)
+{
+	this->id.assign(id.data(), id.size());
+	this->success = true;
+	this->data.clear();
+	this->errorCode = 0;
+	delete this->measure;
+	this->measure = nullptr;
+	this->deferred = false;
 }
 
 String TcpAnswer::toString()
 {
-	String str = "{\"id\":\"" + this->id + "\", \"success\":" + (this->success ? "true" : "false") + ",";
+	String str;
+	write(str);
+	return str;
+}
+
+void TcpAnswer::write(String& out)
+{
 	if (this->success)
 	{
-		str += "\"data\":" + (this->data == "" ? "[]" : this->data);
+		writeHead(out);
+		if (this->data.empty()) {
+			out += "[]";
+		}
+		else {
+			out += this->data;
+		}
 	}
 	else
 	{
-		str += "\"error\": {\"code\":" + to_string(this->errorCode) + ",\"message\":\"" + this->data + "\"}";
+		out.assign("{\"id\":\"");
+		out += this->id;
+		out += "\", \"success\":false,";
+		char code[16];
+		snprintf(code, sizeof(code), "%d", this->errorCode);
+		out += "\"error\": {\"code\":";
+		out += code;
+		out += ",\"message\":\"";
+		out += this->data;
+		out += "\"}";
 	}
+	out += "}";
+}
 
-	return str + "}\0";
+void TcpAnswer::writeHead(String& out)
+{
+	out.assign("{\"id\":\"");
+	out += this->id;
+	out += "\", \"success\":true,\"data\":";
 }
 
+/**
+ * The measures of the measurements data, in the order of the JSON object (and of SensorMeasure::Channel)
+ */
+static const struct {
+	const char* name;
+	String (SensorMeasure::*getter)();
+} MEASUREMENT_CHANNELS[] = {
+	{ "CO2", &SensorMeasure::getCo2 },
+	{ "temperature", &SensorMeasure::getTemperature },
+	{ "humidity", &SensorMeasure::getHumidity },
+	{ "pressure", &SensorMeasure::getPressure },
+	{ "O2", &SensorMeasure::getO2 },
+	{ "O2Probes", &SensorMeasure::getO2Probes },
+	{ "luminosity", &SensorMeasure::getLuminosity }
+};
+
 void TcpAnswer::setMeasurementsData(SensorMeasure* data) {
-	this->data = "{\"CO2\": " + data->getCo2() + ", \"temperature\": " + data->getTemperature() + ", \"humidity\": " + data->getHumidity() + ", \"pressure\": " + data->getPressure() + ", \"O2\": " + data->getO2() + ", \"luminosity\": " + data->getLuminosity() + "}";
+	setMeasurementsData(data, vector<String>());
+}
+
+void TcpAnswer::setMeasurementsData(SensorMeasure* data, const vector<String>& channels) {
+	this->data = "{";
+
+	for (const auto& channel : MEASUREMENT_CHANNELS) {
+		if (!channels.empty() && find(channels.begin(), channels.end(), channel.name) == channels.end()) {
+			continue;
+		}
+
+		if (this->data.length() > 1) {
+			this->data += ", ";
+		}
+		this->data += "\"";
+		this->data += channel.name;
+		this->data += "\": ";
+		this->data += (data->*channel.getter)();
+	}
+
+	this->data += "}";
+}
+
+UInt TcpAnswer::getMeasurementChannelMask(const vector<String>& channels) {
+	UInt mask = 0;
+	for (UInt index = 0; index < SensorMeasure::CHANNEL_COUNT; index++) {
+		if (channels.empty() || find(channels.begin(), channels.end(), MEASUREMENT_CHANNELS[index].name) != channels.end()) {
+			mask |= 1U << index;
+		}
+	}
+	return mask;
+}
+
+int TcpAnswer::getMeasurementChannel(string_view name) {
+	for (UInt index = 0; index < SensorMeasure::CHANNEL_COUNT; index++) {
+		if (name == MEASUREMENT_CHANNELS[index].name) {
+			return index;
+		}
+	}
+	return -1;
+}
+
+bool TcpAnswer::isMeasurementChannel(const String& name) {
+	for (const auto& channel : MEASUREMENT_CHANNELS) {
+		if (name == channel.name) {
+			return true;
+		}
+	}
+	return false;
 }
 
 void TcpAnswer::setMeasurementErrorsData(list<DriverError> data) {
@@ -42,9 +156,95 @@ void TcpAnswer::setMeasurementErrorsData(list<DriverError> data) {
 	this->data += "]";
 }
 
-void TcpAnswer::setError(String error, int code)
+void TcpAnswer::setFiboxLinkData(vector<FiboxLinkStats> data) {
+	this->data = "[";
+
+	for (const FiboxLinkStats& link : data) {
+		if (this->data.length() > 1) {
+			this->data += ",";
+		}
+		this->data += "{\"serial\": \"" + link.serial + "\", \"attached\": " + String(link.attached ? "true" : "false") + ", \"reattachCount\": " + to_string(link.reattachCount) + ", \"lastReattachLatencyMs\": " + to_string(link.lastReattachLatencyMs) + ", \"maxReattachLatencyMs\": " + to_string(link.maxReattachLatencyMs) + ", \"lastStatus\": " + to_string(link.lastStatus) + ", \"statusBits\": [";
+
+		bool first = true;
+		for (UInt index = 0; index < FIBOX_STATUS_BITS; index++) {
+			if (link.statusCounts[index] == 0U) {
+				continue;
+			}
+
+			char lastSeen[80];
+			strftime(lastSeen, 80, "%Y-%m-%d %H:%M:%S", localtime(&link.statusLastSeen[index]));
+
+			this->data += String(first ? "" : ",") + "{\"code\": " + to_string(1U << index) + ", \"message\": \"" + FiboxStatus::message(index) + "\", \"count\": " + to_string(link.statusCounts[index]) + ", \"lastSeen\": \"" + lastSeen + "\"}";
+			first = false;
+		}
+
+		this->data += "]}";
+	}
+
+	this->data += "]";
+}
+
+void TcpAnswer::setStatsData(string_view channel, const char* window, const WindowStats::Result& stats) {
+	// Appended piece by piece, so the buffer of the answer is reused (no temporary string)
+	char text[400];
+	this->data.assign("{\"channel\": \"");
+	this->data.append(channel.data(), channel.size());
+	this->data += "\", \"window\": \"";
+	this->data += window;
+	snprintf(text, sizeof(text), "\", \"count\": %zu", stats.count);
+	this->data += text;
+
+	if (stats.count > 0) {
+		const struct {
+			const char* name;
+			double value;
+		} values[] = { { "min", stats.min }, { "max", stats.max }, { "mean", stats.mean }, { "stddev", stats.stddev } };
+		for (const auto& value : values) {
+			snprintf(text, sizeof(text), ", \"%s\": %f", value.name, value.value);
+			this->data += text;
+		}
+	} else {
+		this->data += ", \"min\": null, \"max\": null, \"mean\": null, \"stddev\": null";
+	}
+
+	if (stats.lastTimestamp != 0) {
+		this->data += ", \"lastTimestamp\": \"";
+		strftime(text, sizeof(text), "%Y-%m-%d %H:%M:%S", localtime(&stats.lastTimestamp));
+		this->data += text;
+		this->data += "\"}";
+	} else {
+		this->data += ", \"lastTimestamp\": null}";
+	}
+}
+
+void TcpAnswer::setJobData(const Job& job) {
+	this->data = "{\"job\": " + to_string(job.id) + ", \"command\": \"" + job.command + "\", \"state\": \"" + (job.finished ? "DONE" : "RUNNING") + "\"";
+
+	if (job.finished) {
+		this->data += ", \"success\": " + String(job.success ? "true" : "false") + ", \"durationMs\": " + to_string(job.durationMs) + ", \"result\": " + (job.result.empty() ? "null" : job.result);
+	}
+
+	this->data += "}";
+}
+
+void TcpAnswer::setResetReportData(const ResetReport& report) {
+	this->data = "{\"sensors\": [";
+
+	for (const SensorInitResult& sensor : report.sensors) {
+		if (this->data.back() != '[') {
+			this->data += ",";
+		}
+		this->data += "{\"sensor\": \"" + sensor.sensor + "\", \"success\": " + String(sensor.success ? "true" : "false") + ", \"durationMs\": " + to_string(sensor.durationMs) + ", \"error\": ";
+		this->data += sensor.error.empty() ? "null" : "\"" + sensor.error + "\"";
+		this->data += "}";
+	}
+
+	this->data += "]}";
+}
+
+void TcpAnswer::setError(string_view error, int code)
 {
 	this->errorCode = code;
-	this->data = error;
+	this->data.assign(error.data(), error.size());
 	this->success = false;
 }
@@ -3,9 +3,15 @@
 #include "../types.h"
 #include "../sensormeasure.h"
 #include "../drivererror.h"
+#include "../Fibox-driver/FiboxLinkStats.h"
+#include "../windowstats.h"
 #include <list>
+#include <vector>
+#include <string_view>
 using namespace std;
 
+struct Job;
+struct ResetReport;
 
 /**
  * @brief TCP answer builder/helper class.
@@ -22,11 +28,31 @@ public:
 	 */
 	bool success;
 
+	/**
+	 * The measure of a GET_MEASURE answer, sent as a MEASURE frame with the binary protocol (deleted with the answer)
+	 */
+	SensorMeasure* measure;
+
+	/**
+	 * True if the answer is not sent now but pushed later by the server (WAIT of a running job)
+	 */
+	bool deferred;
+
 	/**
 	 * Constructor building and empty tcp answer request with a specific id
 	 * Use the same id as the request to link the answer to the request
 	 */
-	TcpAnswer(String id);
+	TcpAnswer(String id = "");
+	~TcpAnswer();
+
+	TcpAnswer(const TcpAnswer&) = delete;
+	TcpAnswer& operator=(const TcpAnswer&) = delete;
+
+	/**
+	 * Empties the answer to reuse it for another request (the buffers keep their capacity)
+	 * @param id The id of the request
+	 */
+	void reset(string_view id);
 
 	/**
 	 * Returns the JSON string representation of the TcpAnswer
@@ -34,7 +60,55 @@ public:
 	 */
 	String toString();
 
+	/**
+	 * Writes the JSON string representation of the TcpAnswer into a buffer (replacing its content, without reallocating it if it is large enough)
+	 */
+	void write(String& out);
+
+	/**
+	 * Writes the start of a successful answer into a buffer, up to its data (the answer is this start followed by the data and a closing brace)
+	 */
+	void writeHead(String& out);
+
 	void setMeasurementsData(SensorMeasure* data);
+
+	/**
+	 * Sets the measurements data, keeping only some of the measures
+	 * @param data The measure
+	 * @param channels The names of the measures to keep (CO2, temperature, humidity, pressure, O2, O2Probes, luminosity), empty to keep all of them
+	 */
+	void setMeasurementsData(SensorMeasure* data, const vector<String>& channels);
+
+	/**
+	 * Returns true if the name is a measure name of the measurements data
+	 */
+	static bool isMeasurementChannel(const String& name);
+
+	/**
+	 * Returns the measure (SensorMeasure::Channel) of a measure name of the measurements data, -1 if it does not exist
+	 */
+	static int getMeasurementChannel(string_view name);
+
+	/**
+	 * Returns the bitmask of measures (bit index: SensorMeasure::Channel) of a list of measure names, all of them if the list is empty
+	 */
+	static UInt getMeasurementChannelMask(const vector<String>& channels);
 	void setMeasurementErrorsData(list<DriverError> data);
-	void setError(String error, int code = -1);
+	void setFiboxLinkData(vector<FiboxLinkStats> data);
+
+	/**
+	 * Sets the statistics of a measure over a window (min, max, mean and stddev are null without samples)
+	 */
+	void setStatsData(string_view channel, const char* window, const WindowStats::Result& stats);
+
+	/**
+	 * Sets the state of a job, with its outcome once it is finished (the result data of the command, e.g. the reset report)
+	 */
+	void setJobData(const Job& job);
+
+	/**
+	 * Sets the outcome of the initialisation of each sensor during a reset
+	 */
+	void setResetReportData(const ResetReport& report);
+	void setError(string_view error, int code = -1);
 };
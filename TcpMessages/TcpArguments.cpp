@@ -0,0 +1,149 @@
+#include "TcpArguments.h"
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <strings.h>
+
+TcpArguments::TcpArguments(const TcpArgumentSpec* schema, size_t count)
+{
+	this->schema = schema;
+	this->count = count < TCP_REQUEST_MAX_ARGS ? count : TCP_REQUEST_MAX_ARGS;
+	for (size_t index = 0; index < TCP_REQUEST_MAX_ARGS; index++) {
+		this->values[index] = Value{ false, 0, 0, string_view() };
+	}
+}
+
+bool TcpArguments::parse(const TcpRequestArgs& args, String& error)
+{
+	size_t positional = 0;
+	bool named = false;
+	for (string_view arg : args) {
+		size_t separator = arg.find('=');
+		if (separator != string_view::npos) {
+			size_t index = find(arg.substr(0, separator));
+			if (index == count) {
+				error = "L'argument " + String(arg.substr(0, separator)) + " n'existe pas.";
+				return false;
+			}
+			if (!setValue(index, arg.substr(separator + 1), error)) {
+				return false;
+			}
+			named = true;
+			continue;
+		}
+
+		if (named) {
+			error = "Les arguments nommés doivent suivre les arguments positionnels.";
+			return false;
+		}
+		if (positional == count) {
+			error = "Trop d'arguments.";
+			return false;
+		}
+		if (!setValue(positional++, arg, error)) {
+			return false;
+		}
+	}
+
+	// Named arguments only: partial update
+	if (positional == 0 && named) {
+		return true;
+	}
+
+	for (size_t index = 0; index < count; index++) {
+		if (schema[index].required && !values[index].set) {
+			error = "Argument(s) manquant(s).";
+			return false;
+		}
+	}
+	return true;
+}
+
+bool TcpArguments::setValue(size_t index, string_view text, String& error)
+{
+	Value& value = values[index];
+	if (value.set) {
+		error = "L'argument " + String(schema[index].name) + " est donné plusieurs fois.";
+		return false;
+	}
+
+	const char* first = text.data();
+	const char* last = text.data() + text.size();
+	bool valid = !text.empty();
+	switch (schema[index].type) {
+	case TCP_ARGUMENT_INT:
+	case TCP_ARGUMENT_BOOL:
+		valid = parseInt(text, value.intValue);
+		break;
+	case TCP_ARGUMENT_DOUBLE: {
+#if defined(__cpp_lib_to_chars)
+		from_chars_result result = from_chars(first, last, value.doubleValue);
+		valid = valid && result.ec == errc() && result.ptr == last;
+#else
+		// No floating-point from_chars in this standard library: strtod on a bounded copy
+		char number[64];
+		char* end = nullptr;
+		valid = valid && text.size() < sizeof(number);
+		if (valid) {
+			memcpy(number, first, text.size());
+			number[text.size()] = '\0';
+			value.doubleValue = strtod(number, &end);
+			valid = end == number + text.size();
+		}
+#endif
+		break;
+	}
+	case TCP_ARGUMENT_STRING:
+		value.stringValue = text;
+		break;
+	}
+
+	if (!valid) {
+		error = "L'argument " + String(schema[index].name) + " est invalide.";
+		return false;
+	}
+	value.set = true;
+	return true;
+}
+
+bool TcpArguments::parseInt(string_view text, int& value)
+{
+	const char* last = text.data() + text.size();
+	from_chars_result result = from_chars(text.data(), last, value);
+	return !text.empty() && result.ec == errc() && result.ptr == last;
+}
+
+size_t TcpArguments::find(string_view name) const
+{
+	for (size_t index = 0; index < count; index++) {
+		if (strlen(schema[index].name) == name.size() && strncasecmp(schema[index].name, name.data(), name.size()) == 0) {
+			return index;
+		}
+	}
+	return count;
+}
+
+bool TcpArguments::isSet(size_t index) const
+{
+	return index < count && values[index].set;
+}
+
+int TcpArguments::getInt(size_t index, int defaultValue) const
+{
+	return isSet(index) ? values[index].intValue : defaultValue;
+}
+
+double TcpArguments::getDouble(size_t index, double defaultValue) const
+{
+	return isSet(index) ? values[index].doubleValue : defaultValue;
+}
+
+bool TcpArguments::getBool(size_t index, bool defaultValue) const
+{
+	return isSet(index) ? values[index].intValue != 0 : defaultValue;
+}
+
+string_view TcpArguments::getString(size_t index, string_view defaultValue) const
+{
+	return isSet(index) ? values[index].stringValue : defaultValue;
+}
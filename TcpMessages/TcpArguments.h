@@ -0,0 +1,106 @@
+#pragma once
+
+#include "../types.h"
+#include "TcpRequest.h"
+#include <string_view>
+using namespace std;
+
+/**
+ * @brief The type of a command argument.
+ */
+enum TcpArgumentType
+{
+	TCP_ARGUMENT_INT,
+	TCP_ARGUMENT_DOUBLE,
+	TCP_ARGUMENT_BOOL,   // an integer, 0 for false
+	TCP_ARGUMENT_STRING
+};
+
+/**
+ * @brief The description of a command argument.
+ */
+struct TcpArgumentSpec
+{
+	const char* name;      // name of the NAME=value form (case insensitive), also used in the error messages
+	TcpArgumentType type;
+	bool required;         // must be given by a call with positional arguments
+};
+
+/**
+ * @brief Argument parser of a command, driven by the schema of its arguments.
+ *
+ * The arguments are given by position (in the order of the schema) and/or by name (NAME=value, in any order, after the positional ones).
+ * A call with positional arguments must give all the required arguments. A call with named arguments only is a partial update:
+ * the command keeps the current value of the arguments not given (see isSet).
+ * The numbers are parsed with from_chars: nothing is thrown and nothing is allocated for valid arguments.
+ */
+class TcpArguments
+{
+public:
+	/**
+	 * Constructor
+	 * @param schema The arguments of the command, in the positional order
+	 * @param count The number of arguments of the schema (at most TCP_REQUEST_MAX_ARGS)
+	 */
+	TcpArguments(const TcpArgumentSpec* schema, size_t count);
+
+	/**
+	 * Parses the arguments of a request
+	 * @param args The arguments of the request
+	 * @param error The error message, if the arguments are invalid
+	 * @return False if an argument is invalid, unknown or given twice, or if a required argument is missing
+	 */
+	bool parse(const TcpRequestArgs& args, String& error);
+
+	/**
+	 * Returns true if the argument has been given
+	 * @param index The index of the argument in the schema
+	 */
+	bool isSet(size_t index) const;
+
+	/**
+	 * Returns the value of an argument, or a default value if it has not been given
+	 * @param index The index of the argument in the schema
+	 * @param defaultValue The value returned if the argument has not been given
+	 */
+	int getInt(size_t index, int defaultValue = 0) const;
+	double getDouble(size_t index, double defaultValue = 0) const;
+	bool getBool(size_t index, bool defaultValue = false) const;
+	string_view getString(size_t index, string_view defaultValue = string_view()) const;
+
+	/**
+	 * Parses a whole text as an integer (as the INT arguments: "1abc" or " 1" are invalid)
+	 * For the arguments taking either a keyword or a number
+	 * @param text The text
+	 * @param value The parsed integer
+	 * @return False if the text is not an integer
+	 */
+	static bool parseInt(string_view text, int& value);
+
+private:
+	/**
+	 * Parses the value of an argument
+	 * @param index The index of the argument in the schema
+	 * @param text The value
+	 * @param error The error message, if the value is invalid
+	 * @return False if the value is invalid or if the argument is already given
+	 */
+	bool setValue(size_t index, string_view text, String& error);
+
+	/**
+	 * Returns the index of the argument with a name, count if there is none
+	 */
+	size_t find(string_view name) const;
+
+	struct Value
+	{
+		bool set;
+		int intValue;
+		double doubleValue;
+		string_view stringValue;
+	};
+
+	const TcpArgumentSpec* schema;
+	size_t count;
+	Value values[TCP_REQUEST_MAX_ARGS];
+};
@@ -1,36 +1,36 @@
 #include "TcpRequest.h"
 #include "../drivererror.h"
 
-TcpRequest::TcpRequest(char* buffer)
+TcpRequest::TcpRequest(const char* buffer)
 {
-	vector<String> args = getArgs(buffer);
-	if (args.size() <= 1)
+	char separator = ' ';
+	string_view str(buffer);
+	size_t last = str.find_last_not_of(" \n\r\t");
+	str = str.substr(0, last == string_view::npos ? 0 : last + 1);
+
+	// Words space separated: the id, the command name then the arguments
+	string_view words[TCP_REQUEST_MAX_ARGS + 2];
+	size_t count = 0;
+	size_t startIndex = 0;
+	while (true) {
+		size_t endIndex = str.find(separator, startIndex);
+		if (count == TCP_REQUEST_MAX_ARGS + 2) {
+			throw DriverError("Invalid request");
+		}
+		words[count++] = str.substr(startIndex, endIndex == string_view::npos ? string_view::npos : endIndex - startIndex);
+		if (endIndex == string_view::npos) {
+			break;
+		}
+		startIndex = endIndex + 1;
+	}
+
+	if (count <= 1)
 	{
 		throw DriverError("Invalid request");
 	}
-	this->id = args[0];
-	this->commandName = args[1];
-	this->commandArgs = vector<String>(args.begin() + 2, args.end());
+	this->id = words[0];
+	this->commandName = words[1];
+	for (size_t i = 2; i < count; i++) {
+		this->commandArgs.args[this->commandArgs.count++] = words[i];
+	}
 }
-
-vector<String> TcpRequest::getArgs(char* buffer) {
-    char separator = ' ';
-    String str(buffer);
-    str.erase(str.find_last_not_of(" \n\r\t") + 1);
-    vector<String> args;
-
-    int startIndex = 0, endIndex = 0;
-    for (int i = 0; i <= (int)str.size(); i++) {
-
-        // If we reached the end of the word or the end of the input.
-        if (str[i] == separator || i == (int)str.size()) {
-            endIndex = i;
-            String temp;
-            temp.append(str, startIndex, endIndex - startIndex);
-            args.push_back(temp);
-            startIndex = endIndex + 1;
-        }
-    }
-
-    return args;
-}
\ No newline at end of file
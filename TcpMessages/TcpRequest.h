@@ -1,30 +1,47 @@
 #pragma once
 
 #include "../types.h"
-#include <vector>
+#include <string_view>
 using namespace std;
 
+// Maximum number of arguments of a request (SET_CONFIG has 17)
+#define TCP_REQUEST_MAX_ARGS 32
+
 /**
- * @brief TCP request builder/helper class.
+ * @brief The arguments of a TCP request (views on the request buffer, no copy).
  */
-class TcpRequest
+class TcpRequestArgs
 {
 public:
-	/**
-	 * Constructor parsing a request buffer into a TcpRequest object
-	 * @param buffer The buffer containing the request
-	 */
-	TcpRequest(char* buffer);
+	TcpRequestArgs() : count(0) {}
 
-	String commandName;
-	vector<String> commandArgs;
-	String id;
+	size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+	string_view operator[](size_t index) const { return args[index]; }
+	const string_view* begin() const { return args; }
+	const string_view* end() const { return args + count; }
 
 private:
+	friend class TcpRequest;
+
+	string_view args[TCP_REQUEST_MAX_ARGS];
+	size_t count;
+};
+
+/**
+ * @brief TCP request builder/helper class.
+ * The request is tokenized in place: its fields are views on the request buffer, which must outlive it.
+ */
+class TcpRequest
+{
+public:
 	/**
-	 * Parses the request buffer into a vector of arguments (words space separated)
-	 * @param buffer The buffer containing the request
-	 * @return The vector of arguments
+	 * Constructor parsing a request buffer into a TcpRequest object (no allocation)
+	 * @param buffer The buffer containing the request (null-terminated)
 	 */
-	vector<String> getArgs(char* buffer);
+	TcpRequest(const char* buffer);
+
+	string_view commandName;
+	TcpRequestArgs commandArgs;
+	string_view id;
 };
@@ -0,0 +1,714 @@
+#include "commands.h"
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <string_view>
+#include "measuremodule.h"
+#include "measurepublisher.h"
+#include "measurecache.h"
+#include "jobmanager.h"
+#include "sensormeasure.h"
+#include "TcpMessages/TcpRequest.h"
+#include "TcpMessages/TcpArguments.h"
+#include "TcpMessages/TcpAnswer.h"
+#include "TcpMessages/BinaryFrame.h"
+
+using namespace std;
+
+MeasureModule* mm;
+MeasurePublisher* publisher;
+MeasureCache* measureCache;
+JobManager* jobs;
+TcpServer* tcpServer;
+
+// The serialized measure answering the current GET_MEASURE request (nullptr if it is answered without the cache)
+static const MeasureCache::Entry* cachedMeasure;
+
+/**
+ * @brief Resets the sensors in the background.
+ * TCP command syntax : RESET
+ * The answer gives the id of the reset job (the one of the reset in progress, if any). When the reset is done, the
+ * outcome of the job is sent on the same connection with the id of the RESET request: the initialisation outcome and
+ * duration of each sensor, in order until the first failure (see WAIT).
+ *
+ * @param connection The id of the client connection.
+ * @param request The TCP request object.
+ * @param answer The TCP answer object.
+ */
+void resetSensors(int connection, TcpRequest* request, TcpAnswer* answer) {
+    const Job* job = jobs->findRunning("RESET");
+    if (job != nullptr) {
+        jobs->wait(job->id, connection, String(request->id));
+    }
+    else {
+        job = jobs->start("RESET", connection, String(request->id));
+        UInt id = job->id;
+        mm->reset([id](const ResetReport& report) {
+            TcpAnswer result;
+            result.setResetReportData(report);
+            jobs->complete(id, report.success, result.data);
+        });
+    }
+    answer->setJobData(*job);
+}
+
+/**
+ * @brief The arguments of WAIT.
+ */
+enum WaitArgument {
+    ARG_WAIT_JOB
+};
+
+/**
+ * @brief The schema of the WAIT arguments.
+ */
+static const TcpArgumentSpec WAIT_ARGUMENTS[] = {
+    { "JOB", TCP_ARGUMENT_INT, true }
+};
+
+/**
+ * @brief Waits for the end of a job (RESET...).
+ * TCP command syntax : WAIT <JOB>
+ * The answer is sent when the job is done (at once if it is already done), its data is the outcome of the job.
+ * The last finished jobs only are kept.
+ *
+ * @param connection The id of the client connection.
+ * @param request The TCP request object.
+ * @param answer The TCP answer object.
+ */
+void waitJob(int connection, TcpRequest* request, TcpAnswer* answer) {
+    TcpArguments args(WAIT_ARGUMENTS, sizeof(WAIT_ARGUMENTS) / sizeof(WAIT_ARGUMENTS[0]));
+    String error;
+    if (!args.parse(request->commandArgs, error)) {
+        answer->setError(error);
+        return;
+    }
+
+    int id = args.getInt(ARG_WAIT_JOB);
+    const Job* job = id > 0 ? jobs->find(id) : nullptr;
+    if (job == nullptr) {
+        answer->setError("La tâche " + to_string(id) + " n'existe pas.");
+        return;
+    }
+
+    if (jobs->wait(job->id, connection, String(request->id))) {
+        answer->deferred = true;
+    }
+    else {
+        answer->setJobData(*job);
+    }
+}
+
+/**
+ * @brief The arguments of SET_CONFIG, in the positional order.
+ */
+enum SetConfigArgument {
+    ARG_ALTITUDE, ARG_F1, ARG_M, ARG_DPHI1, ARG_DPHI2, ARG_DKSV1, ARG_DKSV2, ARG_PRESSURE, ARG_CAL0, ARG_CAL2ND, ARG_T0, ARG_T2ND, ARG_O2CAL2ND, ARG_CALIB_IS_HUMID, ARG_ENABLE_FIBOX_TEMP, ARG_HUMID_MODE, ARG_FIBOX_SERIAL
+};
+
+/**
+ * @brief The schema of the SET_CONFIG arguments.
+ */
+static const TcpArgumentSpec SET_CONFIG_ARGUMENTS[] = {
+    { "ALTITUDE", TCP_ARGUMENT_INT, true },
+    { "F1", TCP_ARGUMENT_DOUBLE, true },
+    { "M", TCP_ARGUMENT_DOUBLE, true },
+    { "DPHI1", TCP_ARGUMENT_DOUBLE, true },
+    { "DPHI2", TCP_ARGUMENT_DOUBLE, true },
+    { "DKSV1", TCP_ARGUMENT_DOUBLE, true },
+    { "DKSV2", TCP_ARGUMENT_DOUBLE, true },
+    { "PRESSURE", TCP_ARGUMENT_DOUBLE, true },
+    { "CAL0", TCP_ARGUMENT_DOUBLE, true },
+    { "CAL2ND", TCP_ARGUMENT_DOUBLE, true },
+    { "T0", TCP_ARGUMENT_DOUBLE, true },
+    { "T2ND", TCP_ARGUMENT_DOUBLE, true },
+    { "O2CAL2ND", TCP_ARGUMENT_DOUBLE, true },
+    { "CALIB_IS_HUMID", TCP_ARGUMENT_BOOL, true },
+    { "ENABLE_FIBOX_TEMP", TCP_ARGUMENT_BOOL, true },
+    { "HUMID_MODE", TCP_ARGUMENT_BOOL, true },
+    { "FIBOX_SERIAL", TCP_ARGUMENT_STRING, false }
+};
+
+/**
+ * @brief Sets the configuration of the sensors.
+ * TCP command syntax : SET_CONFIG <ALTITUDE> <F1> <M> <DPHI1> <DPHI2> <DKSV1> <DKSV2> <PRESSURE> <CAL0> <CAL2ND> <T0> <T2ND> <O2CAL2ND> <CALIB_IS_HUMID> <ENABLE_FIBOX_TEMP> <HUMID_MODE> [FIBOX_SERIAL]
+ * or SET_CONFIG <NAME>=<VALUE> ... (e.g. SET_CONFIG CAL0=57.3 FIBOX_SERIAL=123): only the given fields change, the others keep their current value.
+ * Without FIBOX_SERIAL, the calibration is applied to all the Fibox probes.
+ *
+ * @param request The TCP request object.
+ * @param answer The TCP answer object.
+ */
+void setConfig(TcpRequest* request, TcpAnswer* answer) {
+    TcpArguments args(SET_CONFIG_ARGUMENTS, sizeof(SET_CONFIG_ARGUMENTS) / sizeof(SET_CONFIG_ARGUMENTS[0]));
+    String error;
+    if (!args.parse(request->commandArgs, error)) {
+        answer->setError(error);
+        return;
+    }
+
+    // The fields not given keep the value of the current calibration of the target
+    String serial = String(args.getString(ARG_FIBOX_SERIAL));
+    shared_ptr<const MeasureConfig> current = mm->getConfig(serial);
+    if (current == nullptr) {
+        answer->setError("Aucun Fibox ne correspond au numéro de série donné.");
+        return;
+    }
+
+    if (!mm->setConfig(args.getInt(ARG_ALTITUDE, current->altitude),
+            args.getDouble(ARG_F1, current->F1),
+            args.getDouble(ARG_M, current->M),
+            args.getDouble(ARG_DPHI1, current->DPHI1),
+            args.getDouble(ARG_DPHI2, current->DPHI2),
+            args.getDouble(ARG_DKSV1, current->DKSV1),
+            args.getDouble(ARG_DKSV2, current->DKSV2),
+            args.getDouble(ARG_PRESSURE, current->pressure),
+            args.getDouble(ARG_CAL0, current->cal0),
+            args.getDouble(ARG_CAL2ND, current->cal2nd),
+            args.getDouble(ARG_T0, current->t0),
+            args.getDouble(ARG_T2ND, current->t2nd),
+            args.getDouble(ARG_O2CAL2ND, current->o2Cal2nd),
+            args.getBool(ARG_CALIB_IS_HUMID, current->calibIsHumid),
+            args.getBool(ARG_ENABLE_FIBOX_TEMP, current->enableTempFibox),
+            args.getBool(ARG_HUMID_MODE, current->humidMode),
+            serial)) {
+        answer->setError("Aucun Fibox ne correspond au numéro de série donné.");
+    }
+}
+
+/**
+ * @brief The arguments of SAVE_PROFILE and LOAD_PROFILE.
+ */
+enum ProfileArgument {
+    ARG_PROFILE_NAME, ARG_PROFILE_FIBOX_SERIAL
+};
+
+/**
+ * @brief The schema of the SAVE_PROFILE and LOAD_PROFILE arguments.
+ */
+static const TcpArgumentSpec PROFILE_ARGUMENTS[] = {
+    { "NAME", TCP_ARGUMENT_STRING, true },
+    { "FIBOX_SERIAL", TCP_ARGUMENT_STRING, false }
+};
+
+/**
+ * @brief Saves the current calibration as a named profile.
+ * TCP command syntax : SAVE_PROFILE <NAME> [FIBOX_SERIAL]
+ * Without FIBOX_SERIAL, the default calibration (given by SET_CONFIG without serial number) is saved.
+ *
+ * @param request The TCP request object.
+ * @param answer The TCP answer object.
+ */
+void saveProfile(TcpRequest* request, TcpAnswer* answer) {
+    TcpArguments args(PROFILE_ARGUMENTS, sizeof(PROFILE_ARGUMENTS) / sizeof(PROFILE_ARGUMENTS[0]));
+    String error;
+    if (!args.parse(request->commandArgs, error)) {
+        answer->setError(error);
+        return;
+    }
+
+    if (!args.isSet(ARG_PROFILE_NAME)) {
+        answer->setError("Argument(s) manquant(s).");
+        return;
+    }
+
+    if (!mm->saveProfile(String(args.getString(ARG_PROFILE_NAME)), String(args.getString(ARG_PROFILE_FIBOX_SERIAL)))) {
+        answer->setError("Aucun Fibox ne correspond au numéro de série donné.");
+    }
+}
+
+/**
+ * @brief Switches the calibration to a named profile (the o2 values are recalculated, not cleared).
+ * TCP command syntax : LOAD_PROFILE <NAME> [FIBOX_SERIAL]
+ * Without FIBOX_SERIAL, the profile is applied to all the Fibox probes.
+ *
+ * @param request The TCP request object.
+ * @param answer The TCP answer object.
+ */
+void loadProfile(TcpRequest* request, TcpAnswer* answer) {
+    TcpArguments args(PROFILE_ARGUMENTS, sizeof(PROFILE_ARGUMENTS) / sizeof(PROFILE_ARGUMENTS[0]));
+    String error;
+    if (!args.parse(request->commandArgs, error)) {
+        answer->setError(error);
+        return;
+    }
+
+    if (!args.isSet(ARG_PROFILE_NAME)) {
+        answer->setError("Argument(s) manquant(s).");
+        return;
+    }
+
+    try {
+        mm->loadProfile(String(args.getString(ARG_PROFILE_NAME)), String(args.getString(ARG_PROFILE_FIBOX_SERIAL)));
+    }
+    catch (const DriverError& e) {
+        answer->setError(e.message);
+    }
+}
+
+/**
+ * @brief The arguments of SET_FAST_MATH.
+ */
+enum SetFastMathArgument {
+    ARG_FAST_MATH_ENABLE
+};
+
+/**
+ * @brief The schema of the SET_FAST_MATH arguments.
+ */
+static const TcpArgumentSpec SET_FAST_MATH_ARGUMENTS[] = {
+    { "ENABLE", TCP_ARGUMENT_BOOL, true }
+};
+
+/**
+ * @brief Selects the oxygen calculation functions: exact (0) or approximated (1, faster, relative error below 1e-7).
+ * TCP command syntax : SET_FAST_MATH <ENABLE>
+ *
+ * @param request The TCP request object.
+ * @param answer The TCP answer object.
+ */
+void setFastMath(TcpRequest* request, TcpAnswer* answer) {
+    TcpArguments args(SET_FAST_MATH_ARGUMENTS, sizeof(SET_FAST_MATH_ARGUMENTS) / sizeof(SET_FAST_MATH_ARGUMENTS[0]));
+    String error;
+    if (!args.parse(request->commandArgs, error)) {
+        answer->setError(error);
+        return;
+    }
+
+    if (!args.isSet(ARG_FAST_MATH_ENABLE)) {
+        answer->setError("Argument(s) manquant(s).");
+        return;
+    }
+
+    mm->setFastMath(args.getBool(ARG_FAST_MATH_ENABLE));
+}
+
+/**
+ * @brief Gets the errors that occurred.
+ * TCP command syntax : GET_ERRORS
+ *
+ * @param answer The TCP answer object.
+ */
+void getErrors(TcpAnswer* answer) {
+    answer->setMeasurementErrorsData(mm->getErrors());
+}
+
+/**
+ * @brief Gets the state of each Fibox (serial number, USB link attached or not, automatic re-attachments count and latency,
+ * last status word and, for each status bit seen, its occurrence count and last occurrence date).
+ * TCP command syntax : GET_FIBOX_STATUS
+ *
+ * @param answer The TCP answer object.
+ */
+void getFiboxStatus(TcpAnswer* answer) {
+    answer->setFiboxLinkData(mm->getFiboxLinkStats());
+}
+
+/**
+ * @brief Gets the sensor measure.
+ * TCP command syntax : GET_MEASURE
+ * The measure is serialized once and shared by the requests until it changes (see MeasureCache).
+ *
+ * @param answer The TCP answer object (the measure is kept in it for the binary protocol).
+ */
+void getSensorMeasure(TcpAnswer* answer) {
+    cachedMeasure = measureCache->get();
+    if (cachedMeasure != nullptr) {
+        return;
+    }
+
+    SensorMeasure* data = mm->get();
+    if (data == nullptr) {
+        if (mm->isInitialising()) {
+            answer->setError("Le dispositif de mesure n'a fini de s'initialiser.", 1);
+        } else {
+            answer->setError("Le dispositif de mesure a probablement été intérrompu à la suite d'une erreur. Pour plus d'information, consultez les erreurs avec GET_ERRORS puis tentez de le réinitialiser avec RESET.", 2);
+        }
+    }
+    else {
+        if (!data->isComplete()) {
+			answer->setError("Le dispositif de mesure n'a pas fini de s'initialiser.", 1);
+            delete data;
+        }
+        else {
+            answer->setMeasurementsData(data);
+            answer->measure = data;
+        }
+    }
+}
+
+/**
+ * @brief The arguments of GET_STATS, in the positional order.
+ */
+enum GetStatsArgument {
+    ARG_STATS_CHANNEL, ARG_STATS_WINDOW, ARG_STATS_FIBOX_SERIAL
+};
+
+/**
+ * @brief The schema of the GET_STATS arguments.
+ */
+static const TcpArgumentSpec GET_STATS_ARGUMENTS[] = {
+    { "CHANNEL", TCP_ARGUMENT_STRING, true },
+    { "WINDOW", TCP_ARGUMENT_STRING, true },
+    { "FIBOX_SERIAL", TCP_ARGUMENT_STRING, false }
+};
+
+/**
+ * @brief Gets the statistics of a measure over a sliding window: sample count, min, max, mean, standard deviation and date of the last sample.
+ * They are updated with each sample, so the answer takes a constant time whatever the window.
+ * TCP command syntax : GET_STATS <CHANNEL> <WINDOW> [FIBOX_SERIAL]
+ * CHANNEL is a measure (CO2, temperature, humidity, pressure, O2, luminosity), WINDOW is 10s, 1m, 10m or 1h.
+ * For O2, FIBOX_SERIAL selects the probe (the main one by default). The pressure is the one measured (not at sea level).
+ *
+ * @param request The TCP request object.
+ * @param answer The TCP answer object.
+ */
+void getStats(TcpRequest* request, TcpAnswer* answer) {
+    TcpArguments args(GET_STATS_ARGUMENTS, sizeof(GET_STATS_ARGUMENTS) / sizeof(GET_STATS_ARGUMENTS[0]));
+    String error;
+    if (!args.parse(request->commandArgs, error)) {
+        answer->setError(error);
+        return;
+    }
+
+    if (!args.isSet(ARG_STATS_CHANNEL) || !args.isSet(ARG_STATS_WINDOW)) {
+        answer->setError("Argument(s) manquant(s).");
+        return;
+    }
+
+    string_view name = args.getString(ARG_STATS_CHANNEL);
+    int channel = TcpAnswer::getMeasurementChannel(name);
+    if (channel < 0 || channel == SensorMeasure::O2_PROBES) {
+        answer->setError("La mesure " + String(name) + " n'existe pas.");
+        return;
+    }
+
+    int window = WindowStats::getWindow(args.getString(ARG_STATS_WINDOW));
+    if (window < 0) {
+        answer->setError("La fenêtre " + String(args.getString(ARG_STATS_WINDOW)) + " n'existe pas.");
+        return;
+    }
+
+    WindowStats::Result stats;
+    if (!mm->getStats((SensorMeasure::Channel)channel, String(args.getString(ARG_STATS_FIBOX_SERIAL)), window, stats)) {
+        answer->setError("Aucun Fibox ne correspond au numéro de série donné.");
+        return;
+    }
+
+    answer->setStatsData(name, WindowStats::getWindowName(window), stats);
+}
+
+/**
+ * @brief The arguments of SET_PROTOCOL.
+ */
+enum SetProtocolArgument {
+    ARG_PROTOCOL, ARG_PROTOCOL_PRECISION
+};
+
+/**
+ * @brief The schema of the SET_PROTOCOL arguments.
+ */
+static const TcpArgumentSpec SET_PROTOCOL_ARGUMENTS[] = {
+    { "PROTOCOL", TCP_ARGUMENT_STRING, true },
+    { "PRECISION", TCP_ARGUMENT_STRING, false }
+};
+
+/**
+ * @brief Selects the protocol of the answers sent to the client (the requests stay text lines).
+ * TCP command syntax : SET_PROTOCOL <TEXT|BINARY> [FLOAT32|FLOAT64]
+ * The answer to this command is sent with the previous protocol. In binary, the measures (GET_MEASURE and
+ * SUBSCRIBE) are sent as MEASURE frames and the other answers as TEXT frames (see BinaryFrame).
+ *
+ * @param connection The id of the client connection.
+ * @param request The TCP request object.
+ * @param answer The TCP answer object.
+ */
+void setProtocol(int connection, TcpRequest* request, TcpAnswer* answer) {
+    TcpArguments args(SET_PROTOCOL_ARGUMENTS, sizeof(SET_PROTOCOL_ARGUMENTS) / sizeof(SET_PROTOCOL_ARGUMENTS[0]));
+    String error;
+    if (!args.parse(request->commandArgs, error)) {
+        answer->setError(error);
+        return;
+    }
+
+    if (!args.isSet(ARG_PROTOCOL)) {
+        answer->setError("Argument(s) manquant(s).");
+        return;
+    }
+
+    TcpProtocol protocol;
+    string_view name = args.getString(ARG_PROTOCOL);
+    if (name == "TEXT" && !args.isSet(ARG_PROTOCOL_PRECISION)) {
+        protocol = TCP_PROTOCOL_TEXT;
+    }
+    else if (name == "BINARY") {
+        string_view precision = args.getString(ARG_PROTOCOL_PRECISION, "FLOAT32");
+        if (precision == "FLOAT32") {
+            protocol = TCP_PROTOCOL_BINARY_FLOAT32;
+        }
+        else if (precision == "FLOAT64") {
+            protocol = TCP_PROTOCOL_BINARY_FLOAT64;
+        }
+        else {
+            answer->setError("La précision " + String(precision) + " n'existe pas.");
+            return;
+        }
+    }
+    else {
+        answer->setError("Le protocole " + String(name) + " n'existe pas.");
+        return;
+    }
+
+    tcpServer->setProtocol(connection, protocol);
+}
+
+/**
+ * @brief The arguments of SUBSCRIBE.
+ */
+enum SubscribeArgument {
+    ARG_SUBSCRIBE_CHANNELS, ARG_SUBSCRIBE_INTERVAL
+};
+
+/**
+ * @brief The schema of the SUBSCRIBE arguments (INTERVAL is a number of seconds or ON_CHANGE).
+ */
+static const TcpArgumentSpec SUBSCRIBE_ARGUMENTS[] = {
+    { "CHANNELS", TCP_ARGUMENT_STRING, true },
+    { "INTERVAL", TCP_ARGUMENT_STRING, true }
+};
+
+/**
+ * @brief Subscribes the client to the measures: the connection then receives a message (with the id of this request) for each new snapshot.
+ * TCP command syntax : SUBSCRIBE <CHANNELS> <INTERVAL|ON_CHANGE>
+ * CHANNELS is ALL or a comma separated list of measures (CO2, temperature, humidity, pressure, O2, O2Probes, luminosity).
+ * INTERVAL is the minimum time between two messages in seconds, ON_CHANGE sends a message only when the measures change.
+ * For a slow client, the oldest messages not sent yet are dropped.
+ *
+ * @param connection The id of the client connection.
+ * @param request The TCP request object.
+ * @param answer The TCP answer object.
+ */
+void subscribe(int connection, TcpRequest* request, TcpAnswer* answer) {
+    TcpArguments args(SUBSCRIBE_ARGUMENTS, sizeof(SUBSCRIBE_ARGUMENTS) / sizeof(SUBSCRIBE_ARGUMENTS[0]));
+    String error;
+    if (!args.parse(request->commandArgs, error)) {
+        answer->setError(error);
+        return;
+    }
+
+    if (!args.isSet(ARG_SUBSCRIBE_CHANNELS) || !args.isSet(ARG_SUBSCRIBE_INTERVAL)) {
+        answer->setError("Argument(s) manquant(s).");
+        return;
+    }
+
+    vector<String> channels;
+    if (args.getString(ARG_SUBSCRIBE_CHANNELS) != "ALL") {
+        String list = String(args.getString(ARG_SUBSCRIBE_CHANNELS));
+        size_t start = 0;
+        while (start <= list.size()) {
+            size_t end = list.find(',', start);
+            if (end == String::npos) {
+                end = list.size();
+            }
+
+            String channel = list.substr(start, end - start);
+            if (!TcpAnswer::isMeasurementChannel(channel)) {
+                answer->setError("La mesure " + channel + " n'existe pas.");
+                return;
+            }
+            channels.push_back(channel);
+            start = end + 1;
+        }
+    }
+
+    int interval = 0;
+    string_view intervalArg = args.getString(ARG_SUBSCRIBE_INTERVAL);
+    if (intervalArg != "ON_CHANGE") {
+        if (!TcpArguments::parseInt(intervalArg, interval) || interval <= 0) {
+            answer->setError("L'argument INTERVAL est invalide.");
+            return;
+        }
+    }
+
+    publisher->subscribe(connection, String(request->id), channels, interval);
+}
+
+/**
+ * @brief Ends the subscription of the client to the measures.
+ * TCP command syntax : UNSUBSCRIBE
+ *
+ * @param connection The id of the client connection.
+ * @param answer The TCP answer object.
+ */
+void unsubscribe(int connection, TcpAnswer* answer) {
+    if (!publisher->unsubscribe(connection)) {
+        answer->setError("Aucun abonnement en cours.");
+    }
+}
+
+/**
+ * @brief The arguments of MULTICAST.
+ */
+enum MulticastArgument {
+    ARG_MULTICAST_GROUP, ARG_MULTICAST_PORT
+};
+
+/**
+ * @brief The schema of the MULTICAST arguments (PORT is required unless GROUP is OFF).
+ */
+static const TcpArgumentSpec MULTICAST_ARGUMENTS[] = {
+    { "GROUP", TCP_ARGUMENT_STRING, true },
+    { "PORT", TCP_ARGUMENT_INT, false }
+};
+
+/**
+ * @brief Starts or stops sending each measure snapshot to a UDP multicast group (local network, TTL 1).
+ * Each datagram is a binary SNAPSHOT frame (see BinaryFrame) with a sequence number to detect the lost ones.
+ * TCP command syntax : MULTICAST <GROUP> <PORT> or MULTICAST OFF
+ *
+ * @param request The TCP request object.
+ * @param answer The TCP answer object.
+ */
+void multicast(TcpRequest* request, TcpAnswer* answer) {
+    TcpArguments args(MULTICAST_ARGUMENTS, sizeof(MULTICAST_ARGUMENTS) / sizeof(MULTICAST_ARGUMENTS[0]));
+    String error;
+    if (!args.parse(request->commandArgs, error)) {
+        answer->setError(error);
+        return;
+    }
+
+    if (args.getString(ARG_MULTICAST_GROUP) == "OFF" && !args.isSet(ARG_MULTICAST_PORT)) {
+        publisher->stopMulticast();
+        return;
+    }
+    if (!args.isSet(ARG_MULTICAST_GROUP) || !args.isSet(ARG_MULTICAST_PORT)) {
+        answer->setError("Argument(s) manquant(s).");
+        return;
+    }
+
+    try {
+        publisher->startMulticast(String(args.getString(ARG_MULTICAST_GROUP)), args.getInt(ARG_MULTICAST_PORT));
+    }
+    catch (const DriverError& e) {
+        answer->setError(e.message);
+    }
+}
+
+/**
+ * @brief A TCP command: its name, its number of arguments and its handler.
+ */
+struct Command {
+    const char* name;
+    size_t minArgs;
+    size_t maxArgs;
+
+    // nullptr: the connection is closed
+    void (*handler)(int connection, TcpRequest* request, TcpAnswer* answer);
+};
+
+/**
+ * @brief The TCP commands, sorted by name (binary search).
+ */
+static const Command COMMANDS[] = {
+    { "CLOSE", 0, TCP_REQUEST_MAX_ARGS, nullptr },
+    { "GET_ERRORS", 0, TCP_REQUEST_MAX_ARGS, [](int, TcpRequest*, TcpAnswer* answer) { getErrors(answer); } },
+    { "GET_FIBOX_STATUS", 0, TCP_REQUEST_MAX_ARGS, [](int, TcpRequest*, TcpAnswer* answer) { getFiboxStatus(answer); } },
+    { "GET_MEASURE", 0, TCP_REQUEST_MAX_ARGS, [](int, TcpRequest*, TcpAnswer* answer) { getSensorMeasure(answer); } },
+    { "GET_STATS", 1, 3, [](int, TcpRequest* request, TcpAnswer* answer) { getStats(request, answer); } },
+    { "LOAD_PROFILE", 1, 2, [](int, TcpRequest* request, TcpAnswer* answer) { loadProfile(request, answer); } },
+    { "MULTICAST", 1, 2, [](int, TcpRequest* request, TcpAnswer* answer) { multicast(request, answer); } },
+    { "RESET", 0, TCP_REQUEST_MAX_ARGS, [](int connection, TcpRequest* request, TcpAnswer* answer) { resetSensors(connection, request, answer); } },
+    { "SAVE_PROFILE", 1, 2, [](int, TcpRequest* request, TcpAnswer* answer) { saveProfile(request, answer); } },
+    { "SET_CONFIG", 1, 17, [](int, TcpRequest* request, TcpAnswer* answer) { setConfig(request, answer); } },
+    { "SET_FAST_MATH", 1, 1, [](int, TcpRequest* request, TcpAnswer* answer) { setFastMath(request, answer); } },
+    { "SET_PROTOCOL", 1, 2, [](int connection, TcpRequest* request, TcpAnswer* answer) { setProtocol(connection, request, answer); } },
+    { "SUBSCRIBE", 2, 2, [](int connection, TcpRequest* request, TcpAnswer* answer) { subscribe(connection, request, answer); } },
+    { "UNSUBSCRIBE", 0, TCP_REQUEST_MAX_ARGS, [](int connection, TcpRequest*, TcpAnswer* answer) { unsubscribe(connection, answer); } },
+    { "WAIT", 1, 1, [](int connection, TcpRequest* request, TcpAnswer* answer) { waitJob(connection, request, answer); } }
+};
+
+/**
+ * @brief Finds a TCP command by its name.
+ *
+ * @param name The name of the command.
+ * @return The command, nullptr if it does not exist.
+ */
+const Command* findCommand(string_view name) {
+    const Command* end = COMMANDS + sizeof(COMMANDS) / sizeof(COMMANDS[0]);
+    const Command* command = lower_bound(COMMANDS, end, name, [](const Command& command, string_view name) { return command.name < name; });
+    return command != end && command->name == name ? command : nullptr;
+}
+
+/**
+ * @brief Handles a client request.
+ * Called by the TCP server (on the event loop thread) for each message received.
+ * The request is parsed in place and the answer reuses its buffers, so no memory is allocated by the request path itself.
+ *
+ * @param connection The id of the client connection.
+ * @param message The received message.
+ * @param response The answer to send back to the client.
+ * @return False to close the client connection.
+ */
+bool handleRequest(int connection, char* message, TcpResponse& response) {
+    // Reused from one request to the next (only used from the event loop thread)
+    static TcpAnswer answer;
+    static String json;
+
+    // Try to parse the buffer into a TcpRequest object
+    try
+    {
+        TcpRequest request(message);
+        answer.reset(request.id);
+        cachedMeasure = nullptr;
+        TcpProtocol protocol = tcpServer->getProtocol(connection);
+
+        const Command* command = findCommand(request.commandName);
+        if (command == nullptr) {
+            answer.setError("Commande inconnue.");
+        }
+        else if (command->handler == nullptr) {
+            // Close the client socket
+            return false;
+        }
+        else if (request.commandArgs.size() < command->minArgs || request.commandArgs.size() > command->maxArgs) {
+            answer.setError("Argument(s) manquant(s).");
+        }
+        else {
+            command->handler(connection, &request, &answer);
+        }
+
+        // A deferred answer is pushed later
+        if (answer.deferred) {
+            return true;
+        }
+
+        // Send a response back to the client
+        if (cachedMeasure != nullptr) {
+            // Only the id is written, the serialized measure is sent as is
+            if (protocol == TCP_PROTOCOL_TEXT) {
+                answer.writeHead(response.data);
+                response.tail = cachedMeasure->json;
+            }
+            else {
+                int precision = protocol == TCP_PROTOCOL_BINARY_FLOAT64 ? 1 : 0;
+                BinaryFrame::encodeMeasureHead(response.data, *cachedMeasure->frames[precision], answer.id);
+                response.tail = cachedMeasure->frameTails[precision];
+            }
+        }
+        else if (protocol == TCP_PROTOCOL_TEXT) {
+            answer.write(response.data);
+        }
+        else if (answer.measure != nullptr) {
+            BinaryFrame::encodeMeasure(response.data, answer.id, answer.measure, TcpAnswer::getMeasurementChannelMask(vector<String>()), protocol == TCP_PROTOCOL_BINARY_FLOAT64);
+        }
+        else {
+            answer.write(json);
+            BinaryFrame::encodeText(response.data, json);
+        }
+    }
+    catch (...)
+    {
+        perror("Error parsing/dealing with request !!");
+    }
+
+    return true;
+}
@@ -0,0 +1,33 @@
+#ifndef COMMANDS_H
+#define COMMANDS_H
+
+#include "tcpserver.h"
+
+class MeasureModule;
+class MeasurePublisher;
+class MeasureCache;
+class JobManager;
+
+/*
+ * The TCP commands of the daemon (their syntax is documented with their handler in commands.cpp).
+ * The handlers use the daemon's components below, created by main() before the event loop runs.
+ */
+extern MeasureModule* mm;
+extern MeasurePublisher* publisher;
+extern MeasureCache* measureCache;
+extern JobManager* jobs;
+extern TcpServer* tcpServer;
+
+/**
+ * @brief Handles a client request.
+ * Called by the TCP server (on the event loop thread) for each message received.
+ * The request is parsed in place and the answer reuses its buffers, so no memory is allocated by the request path itself.
+ *
+ * @param connection The id of the client connection.
+ * @param message The received message.
+ * @param response The answer to send back to the client.
+ * @return False to close the client connection.
+ */
+bool handleRequest(int connection, char* message, TcpResponse& response);
+
+#endif // COMMANDS_H
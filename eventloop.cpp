@@ -0,0 +1,153 @@
+#include "eventloop.h"
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdio.h>
+
+#define MAX_EVENTS 64
+
+EventLoop::EventLoop()
+{
+    this->epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (this->epollFd < 0) {
+        perror("Error creating epoll instance");
+    }
+
+    this->wakeupFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (this->wakeupFd < 0) {
+        perror("Error creating eventfd");
+        return;
+    }
+    addFd(this->wakeupFd, EPOLLIN, [this](uint32_t) {
+        uint64_t count;
+        while (read(this->wakeupFd, &count, sizeof(count)) == sizeof(count)) {}
+
+        // The tasks posted by the running ones are run on the next wake up
+        vector<Task> ready;
+        {
+            lock_guard<mutex> lock(tasksMutex);
+            ready.swap(tasks);
+        }
+        for (Task& task : ready) {
+            task();
+        }
+    });
+}
+
+bool EventLoop::addFd(int fd, uint32_t events, FdHandler handler)
+{
+    {
+        lock_guard<mutex> lock(handlersMutex);
+        handlers[fd] = make_shared<FdHandler>(handler);
+    }
+
+    struct epoll_event ev {};
+    ev.events = events;
+    ev.data.fd = fd;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        perror("Error adding a file descriptor to the event loop");
+        lock_guard<mutex> lock(handlersMutex);
+        handlers.erase(fd);
+        return false;
+    }
+
+    return true;
+}
+
+bool EventLoop::modifyFd(int fd, uint32_t events)
+{
+    struct epoll_event ev {};
+    ev.events = events;
+    ev.data.fd = fd;
+    return epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &ev) == 0;
+}
+
+void EventLoop::removeFd(int fd)
+{
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+
+    lock_guard<mutex> lock(handlersMutex);
+    handlers.erase(fd);
+}
+
+int EventLoop::addTimer(TimerHandler handler)
+{
+    int timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timer < 0) {
+        perror("Error creating timer");
+        return -1;
+    }
+
+    bool added = addFd(timer, EPOLLIN, [timer, handler](uint32_t) {
+        // A re-armed or disarmed timer has no expiration to read: ignore the stale wake up
+        uint64_t expirations = 0;
+        if (read(timer, &expirations, sizeof(expirations)) == sizeof(expirations) && expirations > 0) {
+            handler();
+        }
+    });
+
+    if (!added) {
+        close(timer);
+        return -1;
+    }
+
+    return timer;
+}
+
+void EventLoop::armTimer(int timer, long delayUs)
+{
+    struct itimerspec spec {};
+    spec.it_value.tv_sec = delayUs / 1000000;
+    spec.it_value.tv_nsec = (delayUs % 1000000) * 1000;
+    timerfd_settime(timer, 0, &spec, nullptr);
+}
+
+void EventLoop::removeTimer(int timer)
+{
+    removeFd(timer);
+    close(timer);
+}
+
+void EventLoop::post(Task task)
+{
+    {
+        lock_guard<mutex> lock(tasksMutex);
+        tasks.push_back(move(task));
+    }
+
+    uint64_t one = 1;
+    if (write(wakeupFd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+        perror("Error waking up the event loop");
+    }
+}
+
+void EventLoop::run()
+{
+    struct epoll_event events[MAX_EVENTS];
+
+    while (true) {
+        int count = epoll_wait(epollFd, events, MAX_EVENTS, -1);
+        if (count < 0) {
+            if (errno != EINTR) {
+                perror("Error waiting for events");
+            }
+            continue;
+        }
+
+        for (int i = 0; i < count; i++) {
+            shared_ptr<FdHandler> handler;
+            {
+                lock_guard<mutex> lock(handlersMutex);
+                auto it = handlers.find(events[i].data.fd);
+                if (it == handlers.end()) {
+                    continue; // removed by a previous handler of this batch
+                }
+                handler = it->second;
+            }
+
+            (*handler)(events[i].events);
+        }
+    }
+}
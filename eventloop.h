@@ -0,0 +1,132 @@
+#ifndef EVENTLOOP_H
+#define EVENTLOOP_H
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <stdint.h>
+using namespace std;
+
+/**
+ * @brief The EventLoop class is the daemon's central reactor (epoll based).
+ * File descriptors (sockets, libusb pollfds, timers) are registered with a handler
+ * which is called from the thread running run() when the descriptor is ready.
+ * Registrations can be made from any thread.
+ */
+class EventLoop
+{
+public:
+    /**
+     * @brief Handler called with the ready epoll events (EPOLLIN, EPOLLOUT...).
+     */
+    typedef function<void(uint32_t events)> FdHandler;
+
+    /**
+     * @brief Handler called when a timer expires.
+     */
+    typedef function<void()> TimerHandler;
+
+    /**
+     * @brief Function run on the loop thread (see post).
+     */
+    typedef function<void()> Task;
+
+    /**
+     * @brief Constructs a new EventLoop object (creates the epoll instance and the wake up eventfd).
+     */
+    EventLoop();
+
+    /**
+     * @brief Registers a file descriptor in the loop.
+     *
+     * @param fd The file descriptor to watch.
+     * @param events The epoll events to watch (EPOLLIN, EPOLLOUT, EPOLLET...).
+     * @param handler The handler called when the file descriptor is ready.
+     * @return True on success.
+     */
+    bool addFd(int fd, uint32_t events, FdHandler handler);
+
+    /**
+     * @brief Changes the watched events of a registered file descriptor.
+     *
+     * @param fd The file descriptor.
+     * @param events The new epoll events to watch.
+     * @return True on success.
+     */
+    bool modifyFd(int fd, uint32_t events);
+
+    /**
+     * @brief Unregisters a file descriptor (it is not closed).
+     *
+     * @param fd The file descriptor.
+     */
+    void removeFd(int fd);
+
+    /**
+     * @brief Creates a disarmed timer handled by the loop.
+     *
+     * @param handler The handler called on each expiration.
+     * @return The timer id (a timerfd), -1 on error.
+     */
+    int addTimer(TimerHandler handler);
+
+    /**
+     * @brief Arms (or re-arms) a one shot timer. Pending expirations are discarded.
+     *
+     * @param timer The timer id returned by addTimer.
+     * @param delayUs The delay in microseconds, 0 to disarm the timer.
+     */
+    void armTimer(int timer, long delayUs);
+
+    /**
+     * @brief Unregisters and destroys a timer.
+     *
+     * @param timer The timer id returned by addTimer.
+     */
+    void removeTimer(int timer);
+
+    /**
+     * @brief Runs a function on the thread running run(), e.g. to hand over the result of a worker thread.
+     * Can be called from any thread: the tasks are run in order, after the handlers of the current events.
+     *
+     * @param task The function to run.
+     */
+    void post(Task task);
+
+    /**
+     * @brief Runs the loop forever, dispatching the ready file descriptors to their handlers.
+     */
+    void run();
+
+private:
+    /**
+     * @brief The epoll instance file descriptor.
+     */
+    int epollFd;
+
+    /**
+     * @brief The handlers of the registered file descriptors.
+     * Stored as shared pointers so a handler can unregister itself while it runs.
+     */
+    map<int, shared_ptr<FdHandler>> handlers;
+
+    /**
+     * @brief The mutex protecting the handlers map.
+     */
+    mutex handlersMutex;
+
+    /**
+     * @brief The eventfd waking up the loop when a task is posted.
+     */
+    int wakeupFd;
+
+    /**
+     * @brief The posted tasks not run yet, and the mutex protecting them.
+     */
+    vector<Task> tasks;
+    mutex tasksMutex;
+};
+
+#endif // EVENTLOOP_H
@@ -0,0 +1,99 @@
+#include "jobmanager.h"
+#include <algorithm>
+#include "TcpMessages/TcpAnswer.h"
+#include "TcpMessages/BinaryFrame.h"
+
+JobManager::JobManager(EventLoop* loop, TcpServer* server)
+{
+    this->loop = loop;
+    this->server = server;
+    this->nextId = 1;
+
+    server->addCloseHandler([this](int connection) { removeWaiters(connection); });
+}
+
+const Job* JobManager::start(String command, int connection, String requestId)
+{
+    Job& job = jobs[nextId];
+    job.id = nextId++;
+    job.command = command;
+    job.finished = false;
+    job.success = false;
+    job.durationMs = 0;
+    job.start = chrono::steady_clock::now();
+    job.waiters.push_back(JobWaiter{ connection, requestId });
+    return &job;
+}
+
+const Job* JobManager::find(UInt id)
+{
+    auto it = jobs.find(id);
+    return it != jobs.end() ? &it->second : nullptr;
+}
+
+const Job* JobManager::findRunning(const String& command)
+{
+    for (auto& pair : jobs) {
+        if (!pair.second.finished && pair.second.command == command) {
+            return &pair.second;
+        }
+    }
+    return nullptr;
+}
+
+bool JobManager::wait(UInt id, int connection, String requestId)
+{
+    auto it = jobs.find(id);
+    if (it == jobs.end() || it->second.finished) {
+        return false;
+    }
+    it->second.waiters.push_back(JobWaiter{ connection, requestId });
+    return true;
+}
+
+void JobManager::complete(UInt id, bool success, String result)
+{
+    loop->post([this, id, success, result]() { finish(id, success, result); });
+}
+
+void JobManager::finish(UInt id, bool success, String result)
+{
+    auto it = jobs.find(id);
+    if (it == jobs.end() || it->second.finished) {
+        return;
+    }
+    Job& job = it->second;
+    job.finished = true;
+    job.success = success;
+    job.durationMs = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - job.start).count();
+    job.result = result;
+
+    // The notification is the deferred answer of each waiting request (never dropped for a slow client).
+    // The waiters are taken first: a failed push closes the connection, which removes its waiters.
+    vector<JobWaiter> waiters;
+    waiters.swap(job.waiters);
+    for (const JobWaiter& waiter : waiters) {
+        TcpAnswer answer(waiter.requestId);
+        answer.setJobData(job);
+        if (server->getProtocol(waiter.connection) == TCP_PROTOCOL_TEXT) {
+            server->push(waiter.connection, answer.toString(), false);
+        }
+        else {
+            server->push(waiter.connection, BinaryFrame::encodeText(answer.toString()), false);
+        }
+    }
+
+    finishedJobs.push_back(id);
+    if (finishedJobs.size() > JOB_MAX_FINISHED) {
+        jobs.erase(finishedJobs.front());
+        finishedJobs.pop_front();
+    }
+}
+
+void JobManager::removeWaiters(int connection)
+{
+    for (auto& pair : jobs) {
+        vector<JobWaiter>& waiters = pair.second.waiters;
+        waiters.erase(remove_if(waiters.begin(), waiters.end(), [connection](const JobWaiter& waiter) { return waiter.connection == connection; }), waiters.end());
+    }
+}
@@ -0,0 +1,134 @@
+#ifndef JOBMANAGER_H
+#define JOBMANAGER_H
+
+#include <map>
+#include <deque>
+#include <vector>
+#include <chrono>
+#include "types.h"
+#include "eventloop.h"
+#include "tcpserver.h"
+using namespace std;
+
+// Number of finished jobs kept for WAIT (the oldest are forgotten)
+#define JOB_MAX_FINISHED 16
+
+/**
+ * @brief The JobWaiter struct is a client request waiting for the end of a job.
+ */
+struct JobWaiter
+{
+    int connection;
+    String requestId;
+};
+
+/**
+ * @brief The Job struct is a long running command (RESET...) executed in the background.
+ */
+struct Job
+{
+    UInt id;
+    String command;
+    bool finished;
+    bool success;                             // outcome of the job (once finished)
+    long durationMs;                          // duration of the job (once finished)
+    String result;                            // JSON data given by the command (once finished)
+    chrono::steady_clock::time_point start;
+    vector<JobWaiter> waiters;                // requests answered when the job ends
+};
+
+/**
+ * @brief The JobManager class keeps track of the long running commands: the command answers at once with the id of its
+ * job, and the clients are notified on their connection when the job ends (the client which started it, and the ones
+ * waiting for it with WAIT). The finished jobs are kept for a while so that a late WAIT gets their result.
+ * Only used from the event loop thread, except complete() which can be called from the thread running the job.
+ */
+class JobManager
+{
+public:
+    /**
+     * @brief Constructs a new JobManager object.
+     *
+     * @param loop The event loop running the TCP server.
+     * @param server The TCP server of the clients to notify.
+     */
+    JobManager(EventLoop* loop, TcpServer* server);
+
+    /**
+     * @brief Creates a running job.
+     *
+     * @param command The name of the command.
+     * @param connection The id of the client connection notified when the job ends.
+     * @param requestId The id of the request starting the job (used as id of the notification).
+     * @return The job.
+     */
+    const Job* start(String command, int connection, String requestId);
+
+    /**
+     * @brief Gets a job.
+     *
+     * @param id The id of the job.
+     * @return The job, nullptr if it does not exist (or has been forgotten).
+     */
+    const Job* find(UInt id);
+
+    /**
+     * @brief Gets the running job of a command.
+     *
+     * @param command The name of the command.
+     * @return The job, nullptr if the command has no running job.
+     */
+    const Job* findRunning(const String& command);
+
+    /**
+     * @brief Notifies a client request when a running job ends.
+     *
+     * @param id The id of the job.
+     * @param connection The id of the client connection.
+     * @param requestId The id of the request (used as id of the notification).
+     * @return False if the job does not exist or is already finished.
+     */
+    bool wait(UInt id, int connection, String requestId);
+
+    /**
+     * @brief Ends a job and notifies its waiters (from the event loop thread). Can be called from any thread.
+     *
+     * @param id The id of the job.
+     * @param success The outcome of the job.
+     * @param result The JSON data of the outcome.
+     */
+    void complete(UInt id, bool success, String result);
+
+private:
+    /**
+     * @brief Ends a job and notifies its waiters (see complete).
+     */
+    void finish(UInt id, bool success, String result);
+
+    /**
+     * @brief Forgets the waiters of a closed connection.
+     *
+     * @param connection The id of the client connection.
+     */
+    void removeWaiters(int connection);
+
+    EventLoop* loop;
+    TcpServer* server;
+
+    /**
+     * @brief The running and the finished jobs (key: job id).
+     */
+    map<UInt, Job> jobs;
+
+    /**
+     * @brief The ids of the finished jobs, the oldest first.
+     */
+    deque<UInt> finishedJobs;
+
+    /**
+     * @brief The id of the next job.
+     */
+    UInt nextId;
+};
+
+#endif // JOBMANAGER_H
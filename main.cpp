@@ -1,292 +1,59 @@
 #include <iostream>
 #include "types.h"
 #include <unistd.h>
-#include <sys/socket.h>
-#include <netinet/in.h>
+#include <pwd.h>
+#include <grp.h>
 #include <vector>
+#include <algorithm>
 #include "measuremodule.h"
-#include "sensormeasure.h"
-#include "TcpMessages/TcpRequest.h"
-#include "TcpMessages/TcpAnswer.h"
+#include "eventloop.h"
+#include "tcpserver.h"
+#include "measurepublisher.h"
+#include "measurecache.h"
+#include "jobmanager.h"
+#include "commands.h"
 
 using namespace std;
 
 #define PORT 12778
 
-MeasureModule* mm;
+// Default path of the Unix domain socket (overridden by the DAEMON_UNIX_SOCKET environment variable, disabled if it is empty)
+#define UNIX_SOCKET_PATH "/run/daemon_drivers.sock"
 
-/**
- * @brief Resets the sensors.
- * TCP command syntax : RESET
- */
-void resetSensors() {
-    mm->reset();
-}
-
-/**
- * @brief Sets the configuration of the sensors.
- * TCP command syntax : SET_CONFIG <ALTITUDE> <F1> <M> <DPHI1> <DPHI2> <DKSV1> <DKSV2> <PRESSURE> <CAL0> <CAL2ND> <T0> <T2ND> <O2CAL2ND> <CALIB_IS_HUMID> <HUMID_MODE> <ENABLE_FIBOX_TEMP>
- *
- * @param request The TCP request object.
- * @param answer The TCP answer object.
- */
-void setConfig(TcpRequest* request, TcpAnswer* answer) {
-    int altitude = 0;
-    try {
-        altitude = stoi(request->commandArgs[0]);
-    }
-    catch (...) {
-        answer->setError("L'argument de l'altitude est invalide.");
-        return;
-    }
-    
-    double f1 = 0;
-    double m = 0;
-    double dphi1 = 0;
-    double dphi2 = 0;
-    double dksv1 = 0;
-    double dksv2 = 0;
-
-    try {
-        f1 = stod(request->commandArgs[1]);
-    }
-    catch (...) {
-        answer->setError("L'argument F1 est invalide.");
-        return;
-    }
-
-    try {
-        m = stod(request->commandArgs[2]);
-    }
-    catch (...) {
-        answer->setError("L'argument M est invalide.");
-        return;
-    }
-
-    try {
-        dphi1 = stod(request->commandArgs[3]);
-    }
-    catch (...) {
-        answer->setError("L'argument DPHI1 est invalide.");
-        return;
-    }
-
-    try {
-        dphi2 = stod(request->commandArgs[4]);
-    }
-    catch (...) {
-        answer->setError("L'argument DPHI2 est invalide.");
-        return;
-    }
-
-    try {
-        dksv1 = stod(request->commandArgs[5]);
-    }
-    catch (...) {
-        answer->setError("L'argument DKSV1 est invalide.");
-        return;
-    }
-
-    try {
-        dksv2 = stod(request->commandArgs[6]);
-    }
-    catch (...) {
-        answer->setError("L'argument DKSV2 est invalide.");
-        return;
-    }
-
-    double press = 0;
-    double cal0 = 0;
-    double cal2nd = 0;
-    double t0 = 0;
-    double t2nd = 0;
-    double o2Cal2nd = 0;
-    bool humid = false;
-
-    try {
-        press = stod(request->commandArgs[7]);
-    }
-    catch (...) {
-        answer->setError("L'argument de la pression est invalide.");
-        return;
-    }
-
-    try {
-        cal0 = stod(request->commandArgs[8]);
-    }
-    catch (...) {
-        answer->setError("L'argument cal0 est invalide.");
-        return;
-    }
-
-    try {
-        cal2nd = stod(request->commandArgs[9]);
-    }
-    catch (...) {
-        answer->setError("L'argument cal2nd est invalide.");
-        return;
-    }
-
-    try {
-        t0 = stod(request->commandArgs[10]);
-    }
-    catch (...) {
-        answer->setError("L'argument t0 est invalide.");
-        return;
-    }
-
-    try {
-        t2nd = stod(request->commandArgs[11]);
-    }
-    catch (...) {
-        answer->setError("L'argument t2nd est invalide.");
-        return;
-    }
-
-    try {
-        o2Cal2nd = stod(request->commandArgs[12]);
-    }
-    catch (...) {
-        answer->setError("L'argument o2Cal2nd est invalide.");
-        return;
-    }
-
-    try {
-        humid = (bool)stoi(request->commandArgs[13]);
-    }
-    catch (...) {
-        answer->setError("L'argument CALIB_IS_HUMID est invalide.");
-        return;
-    }
-
-    bool enableFiboxTemp = false;
-    bool humidMode = false;
-
-    try {
-        enableFiboxTemp = (bool)stoi(request->commandArgs[14]);
-    }
-    catch (...) {
-        answer->setError("L'argument ENABLE_FIBOX_TEMP est invalide.");
-        return;
-    }
-
-    try {
-        humidMode = (bool)stoi(request->commandArgs[15]);
-    }
-    catch (...) {
-        answer->setError("L'argument ENABLE_FIBOX_TEMP est invalide.");
-        return;
-    }
-
-    mm->setConfig(altitude, f1, m, dphi1, dphi2, dksv1, dksv2, press, cal0, cal2nd, t0, t2nd, o2Cal2nd, humid, humidMode, enableFiboxTemp);
-}
-
-/**
- * @brief Gets the errors that occurred.
- * TCP command syntax : GET_ERRORS
- *
- * @param answer The TCP answer object.
- */
-void getErrors(TcpAnswer* answer) {
-    answer->setMeasurementErrorsData(mm->getErrors());
-}
+// The latest snapshot is also written to this shared memory segment (overridden by the DAEMON_SHM_NAME environment variable, disabled if it is empty)
+#define SHM_NAME MEASURE_SNAPSHOT_SEGMENT_NAME
 
 /**
- * @brief Gets the sensor measure.
- * TCP command syntax : GET_MEASURE
+ * @brief Access control of the Unix domain socket: only root, the daemon's user and the members of the daemon's group
+ * (as primary or supplementary group) are accepted.
  *
- * @param answer The TCP answer object.
+ * @param peer The credentials of the client process.
+ * @return True to accept the client.
  */
-void getSensorMeasure(TcpAnswer* answer) {
-    SensorMeasure* data = mm->get();
-    if (data == nullptr) {
-        if (mm->isInitialising()) {
-            answer->setError("Le dispositif de mesure n'a fini de s'initialiser.", 1);
-            return;
-        } else {
-            answer->setError("Le dispositif de mesure a probablement été intérrompu à la suite d'une erreur. Pour plus d'information, consultez les erreurs avec GET_ERRORS puis tentez de le réinitialiser avec RESET.", 2);
-            return;
-        }
-    }
-    else {
-        if (!data->isComplete()) {
-			answer->setError("Le dispositif de mesure n'a pas fini de s'initialiser.", 1);
-        }
-        else {
-            answer->setMeasurementsData(data);
-        }
-    }
-}
-
-/**
- * @brief Handles a client request.
- *
- * @param clientSocket The client socket.
- */
-void handleClient(int clientSocket) {
-    while (true) {
-        char buffer[256];
-        ssize_t bytesRead;
-
-        // Read data from the client
-        bytesRead = read(clientSocket, buffer, sizeof(buffer));
-        if (bytesRead < 0) {
-            perror("Error reading from socket");
-            close(clientSocket);
-            return;
-        } else if (bytesRead == 0) {
-            // Connection closed by the client or lostn
-            close(clientSocket);
-            return;
-        }
-
-        // Null-terminate the received data
-        buffer[bytesRead] = '\0';
-
-        // Try to paste the buffer into a TcpRequest object
-        try
-        {
-            TcpRequest* request = new TcpRequest(buffer);
-            TcpAnswer* answer = new TcpAnswer(request->id);
-
-            if (request->commandName == "RESET") {
-                resetSensors();
-            }
-            else if (request->commandName == "SET_CONFIG") {
-                if (request->commandArgs.size() != 16) {
-                    answer->setError("Argument(s) manquant(s).");
-                }
-                else {
-                    setConfig(request, answer);
-                }
-            }
-            else if (request->commandName == "GET_MEASURE") {
-                getSensorMeasure(answer);
-            }
-            else if (request->commandName == "GET_ERRORS") {
-                getErrors(answer);
-            }
-            else if (request->commandName == "CLOSE") {
-                // Close the client socket
-                close(clientSocket);
-                return;
-            }
-            else {
-                answer->setError("Commande inconnue.");
-            }
-
-            // Send a response back to the client
-            const String response = answer->toString();
-            write(clientSocket, response.c_str(), response.length());
-
-            delete request;
-            delete answer;
-        }
-        catch (...)
-        {
-            perror("Error parsing/dealing with request !!");
+bool isLocalClientAllowed(const struct ucred& peer) {
+    if (peer.uid == 0 || peer.uid == geteuid() || peer.gid == getegid()) {
+        return true;
+    }
+
+    // Supplementary groups: the groups of the client's user (the peer credentials only give its primary group)
+    long bufferSize = sysconf(_SC_GETPW_R_SIZE_MAX);
+    vector<char> buffer(bufferSize > 0 ? bufferSize : 16384);
+    struct passwd user;
+    struct passwd* found = nullptr;
+    if (getpwuid_r(peer.uid, &user, buffer.data(), buffer.size(), &found) != 0 || found == nullptr) {
+        return false;
+    }
+
+    int count = 32;
+    vector<gid_t> groups(count);
+    while (getgrouplist(user.pw_name, user.pw_gid, groups.data(), &count) == -1) {
+        // count has been set to the number of groups of the user
+        if (count <= (int)groups.size()) {
+            return false;
         }
+        groups.resize(count);
     }
+    return find(groups.begin(), groups.begin() + count, getegid()) != groups.begin() + count;
 }
 
 /**
@@ -295,56 +62,48 @@ void handleClient(int clientSocket) {
  * @return The exit code.
  */
 int main() {
-    mm = new MeasureModule();
-
-    // Create a socket
-    int serverSocket = socket(AF_INET, SOCK_STREAM, 0);
-    if (serverSocket < 0) {
-        perror("Error creating socket");
-        return EXIT_FAILURE;
-    }
+    // The event loop handling the USB events, the timers and the TCP server sockets
+    EventLoop loop;
 
-    // Set up the server address structure
-    struct sockaddr_in serverAddress {};
-    serverAddress.sin_family = AF_INET;
-    serverAddress.sin_addr.s_addr = INADDR_ANY;
-    serverAddress.sin_port = htons(PORT); // Port number
+    mm = new MeasureModule(&loop);
+    measureCache = new MeasureCache(mm);
 
-    // Bind the socket to the specified address and port
-    if (bind(serverSocket, (struct sockaddr*)&serverAddress, sizeof(serverAddress)) < 0) {
-        perror("Error binding socket");
-        close(serverSocket);
+    // The TCP server runs on the event loop (no thread per client)
+    TcpServer server(&loop, handleRequest);
+    tcpServer = &server;
+    if (!server.listen(PORT)) {
         return EXIT_FAILURE;
     }
 
-    // Listen for incoming connections (max connexctions: 5)
-    if (listen(serverSocket, 5) < 0) {
-        perror("Error listening for connections");
-        close(serverSocket);
-        return EXIT_FAILURE;
+    // The local clients can use the Unix domain socket instead of the TCP stack
+    const char* unixSocketEnv = getenv("DAEMON_UNIX_SOCKET");
+    String unixSocketPath = unixSocketEnv != nullptr ? unixSocketEnv : UNIX_SOCKET_PATH;
+    if (!unixSocketPath.empty() && server.listenUnix(unixSocketPath, isLocalClientAllowed)) {
+        cout << "Daemon listening on " << unixSocketPath << "..." << endl;
     }
 
-    cout << "Daemon listening on port " << PORT << "..." << endl;
+    // The long running commands (RESET) notify their clients when they end
+    jobs = new JobManager(&loop, &server);
 
-    // Accept and handle incoming connections
-    while (true) {
-        struct sockaddr_in clientAddress {};
-        socklen_t clientAddressLength = sizeof(clientAddress);
+    // The measure snapshots pushed to the subscribed clients
+    publisher = new MeasurePublisher(&loop, &server, mm);
 
-        // Accept a new connection
-        int clientSocket = accept(serverSocket, (struct sockaddr*)&clientAddress, &clientAddressLength);
-        if (clientSocket < 0) {
-            perror("Error accepting connection");
-            continue;
+    // The local clients can read the latest snapshot without any request (see measuresnapshot.h)
+    const char* shmEnv = getenv("DAEMON_SHM_NAME");
+    String shmName = shmEnv != nullptr ? shmEnv : SHM_NAME;
+    if (!shmName.empty()) {
+        try {
+            publisher->startSharedMemory(shmName);
+            cout << "Daemon writing the snapshots to the shared memory segment " << shmName << "..." << endl;
+        }
+        catch (const DriverError& e) {
+            cerr << e.message << endl;
         }
-
-        // Handle the client in a separate function
-        thread t(handleClient, clientSocket);
-        t.detach();
     }
 
-    // Close the server socket (this part will not be reached)
-    close(serverSocket);
+    cout << "Daemon listening on port " << PORT << "..." << endl;
+
+    loop.run();
 
     return EXIT_SUCCESS;
 }
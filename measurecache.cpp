@@ -0,0 +1,46 @@
+#include "measurecache.h"
+#include "TcpMessages/TcpAnswer.h"
+#include "TcpMessages/BinaryFrame.h"
+
+MeasureCache::MeasureCache(MeasureModule* module)
+{
+    this->module = module;
+    this->valid = false;
+    this->loaded = false;
+    this->generation = 0;
+}
+
+const MeasureCache::Entry* MeasureCache::get()
+{
+    if (module->isInitialising() || module->isStopped()) {
+        return nullptr;
+    }
+
+    // the generation is read first: a sample added while the measure is computed invalidates it
+    UInt current = module->getGeneration();
+    if (loaded && current == generation) {
+        return valid ? &entry : nullptr;
+    }
+
+    SensorMeasure* measure = module->get(false);
+    loaded = true;
+    generation = current;
+    valid = measure != nullptr && measure->isComplete();
+    if (valid) {
+        TcpAnswer answer;
+        answer.setMeasurementsData(measure);
+        answer.data += "}";
+        entry.json = make_shared<const String>(move(answer.data));
+
+        UInt channelMask = TcpAnswer::getMeasurementChannelMask(vector<String>());
+        for (int precision = 0; precision < 2; precision++) {
+            String frame;
+            BinaryFrame::encodeMeasure(frame, "", measure, channelMask, precision == 1);
+            entry.frameTails[precision] = make_shared<const String>(frame.substr(BINARY_FRAME_MEASURE_ID_OFFSET + 1));
+            entry.frames[precision] = make_shared<const String>(move(frame));
+        }
+    }
+    delete measure;
+
+    return valid ? &entry : nullptr;
+}
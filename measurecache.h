@@ -0,0 +1,71 @@
+#ifndef MEASURECACHE_H
+#define MEASURECACHE_H
+
+#include <memory>
+#include "types.h"
+#include "measuremodule.h"
+using namespace std;
+
+/**
+ * @brief The MeasureCache class keeps the answer of GET_MEASURE serialized once per measure, in each format.
+ * The measure is computed and serialized again only when the generation of the measure module changes (a sample is
+ * added, a configuration is set...): the other requests only write their id before the cached bytes, which are
+ * shared with the pending answers instead of being copied (see TcpResponse).
+ * Only used from the event loop thread.
+ */
+class MeasureCache
+{
+public:
+    /**
+     * @brief The serialized measure.
+     */
+    struct Entry
+    {
+        /**
+         * @brief The end of the JSON answer: the measurements data followed by the closing brace of the answer.
+         */
+        shared_ptr<const String> json;
+
+        /**
+         * @brief The MEASURE frames encoded with an empty id (index 0: float32, 1: float64).
+         */
+        shared_ptr<const String> frames[2];
+
+        /**
+         * @brief The end of the MEASURE frames, after the id (see BinaryFrame::encodeMeasureHead).
+         */
+        shared_ptr<const String> frameTails[2];
+    };
+
+    /**
+     * @brief Constructs a new MeasureCache object.
+     *
+     * @param module The measure module.
+     */
+    MeasureCache(MeasureModule* module);
+
+    /**
+     * @brief Gets the serialized measure, serializing it again if the measure module changed.
+     *
+     * @return The serialized measure, nullptr if the measure is not available or not complete (the request
+     * must then be answered without the cache, to report the error).
+     */
+    const Entry* get();
+
+private:
+    MeasureModule* module;
+
+    /**
+     * @brief The serialized measure (not valid if the measure was not complete).
+     */
+    Entry entry;
+    bool valid;
+
+    /**
+     * @brief True once the measure has been read, and the generation of the measure module at that time.
+     */
+    bool loaded;
+    UInt generation;
+};
+
+#endif // MEASURECACHE_H
@@ -72,12 +72,20 @@ void MeasureModule::lightSensorMeasureClock()
     }
 }
 
-void MeasureModule::fiboxMeasureClock()
+void MeasureModule::fiboxMeasureClock(FiboxChannel* channel)
 {
     while (true) {
-        if (!stopped) {
+        if (!stopped && !channel->driver->isAttached()) {
+            // Fibox unplugged: drop its stale values until the hotplug detection re-attaches it
+            clearO2Samples(channel);
+        }
+        else if (!stopped) {
             try {
-                FiboxAnswer* data = fiboxDriver.getMeasure();
+                FiboxAnswer* data = channel->driver->getMeasure();
+
+                // the whole sample is computed with the same calibration profile
+                shared_ptr<const MeasureConfig> profile = atomic_load(&channel->config);
+                channel->oxyCalculator->setConfig(profile.get());
 
                 if (data->isTemperatureEnabled) {
                     addTemperatureSample((float)data->temperature);
@@ -93,7 +101,7 @@ void MeasureModule::fiboxMeasureClock()
                 {
                     avgTemperature = (float)data->temperature;
                 }
-                oxyCalculator->setTemperature(avgTemperature);
+                channel->oxyCalculator->setTemperature(avgTemperature);
 
                 float avgPressure = 0.0f;
                 try
@@ -104,20 +112,25 @@ void MeasureModule::fiboxMeasureClock()
                 {
 					avgPressure = (float)data->pressure;
 				}
-                oxyCalculator->setPressure(avgPressure);
+                channel->oxyCalculator->setPressure(avgPressure);
 
-                oxyCalculator->setPhaseAngle((float)data->phase);
+                channel->oxyCalculator->setPhaseAngle((float)data->phase);
                 
-                float o2 = (float)oxyCalculator->getOxygenValue();
+                float o2 = (float)channel->oxyCalculator->getOxygenValue();
                 if (isnanf(o2) || isinff(o2)) {
 					throw DriverError("La valeur d'oxygène calculé n'était pas un nombre. Vérifier vos valeurs de calibration.");
                 }
-                addO2Sample(o2);
+                addO2Sample(channel, o2, FiboxSample{ (float)data->phase, avgTemperature, avgPressure, time(nullptr), profile->version });
             } catch (const DriverError& e) {
                 errorArray.push_front(e);
-                this->stopped = true;
+                if (channel->driver->isAttached()) {
+                    this->stopped = true;
+                } else {
+                    // Lost the USB link: only the o2 channel is affected, the I2C sensors keep measuring
+                    clearO2Samples(channel);
+                }
             } catch (...) {
-                errorArray.push_front(DriverError("Une errreur inconnue est survenu dans la boucle de mesure du capteur Fibox."));
+                errorArray.push_front(DriverError("Une errreur inconnue est survenu dans la boucle de mesure du capteur Fibox " + channel->driver->getSerial() + "."));
                 this->stopped = true;
             }
         }
@@ -224,7 +237,7 @@ void MeasureModule::stc31CalibrationClock()
 
                     if (temperature != __FLT_MIN__ && pressure != __FLT_MIN__) {
                         // convert to pressure at altitude to pressure at sea level
-                        pressure = pressureAtSeaLevel(temperature, pressure, this->config->altitude);
+                        pressure = pressureAtSeaLevel(temperature, pressure, atomic_load(&this->config)->altitude);
                     }
                 } catch (const DriverError& e) {}
 
@@ -277,49 +290,118 @@ void MeasureModule::stc31CalibrationClock()
 void MeasureModule::addTemperatureSample(float temperature)
 {
     temperatureArray.push_front(temperature);
+    temperatureStats.add(temperature);
     if (temperatureArray.size() > NB_OF_SAMPLE * NB_TEMPERATURE_SENSOR) {
         temperatureArray.pop_back();
     }
+    generation++;
 }
 
 void MeasureModule::addPressureSample(float pressure)
 {
     pressureArray.push_front(pressure);
+    pressureStats.add(pressure);
     if (pressureArray.size() > NB_OF_SAMPLE * NB_PRESSURE_SENSOR) {
         pressureArray.pop_back();
     }
+    generation++;
 }
 
 void MeasureModule::addHumiditySample(float humidity)
 {
     humidityArray.push_front(humidity);
+    humidityStats.add(humidity);
     if (humidityArray.size() > NB_OF_SAMPLE * NB_HUMIDITY_SENSOR) {
         humidityArray.pop_back();
     }
+    generation++;
 }
 
 void MeasureModule::addCo2Sample(float co2)
 {
     co2Array.push_front(co2);
+    co2Stats.add(co2);
     if (co2Array.size() > NB_OF_SAMPLE * NB_CO2_SENSOR) {
         co2Array.pop_back();
     }
+    generation++;
 }
 
-void MeasureModule::addO2Sample(float o2)
+void MeasureModule::addO2Sample(FiboxChannel* channel, float o2, FiboxSample input)
 {
-    o2Array.push_front(o2);
-    if (o2Array.size() > NB_OF_SAMPLE * NB_O2_SENSOR) {
-        o2Array.pop_back();
+    lock_guard<mutex> lock(channel->samplesMutex);
+
+    // the profile has been swapped (and the window recomputed) while this sample was computed
+    shared_ptr<const MeasureConfig> profile = atomic_load(&channel->config);
+    if (input.profileVersion != profile->version) {
+        double value = 0;
+        OxygenCalculation::computeBatch(*profile, &input.phase, &input.temperature, &input.pressure, &value, 1);
+        o2 = (float)value;
+        input.profileVersion = profile->version;
+        if (isnanf(o2) || isinff(o2)) {
+            return;
+        }
+    }
+
+    channel->o2Array.push_front(o2);
+    channel->rawSamples.push_front(input);
+    channel->o2Stats.add(o2);
+    if (channel->o2Array.size() > NB_OF_SAMPLE * NB_O2_SENSOR) {
+        channel->o2Array.pop_back();
+        channel->rawSamples.pop_back();
+    }
+    generation++;
+}
+
+void MeasureModule::clearO2Samples(FiboxChannel* channel)
+{
+    lock_guard<mutex> lock(channel->samplesMutex);
+    channel->o2Array.clear();
+    channel->rawSamples.clear();
+    generation++;
+}
+
+void MeasureModule::recomputeO2Samples(FiboxChannel* channel)
+{
+    lock_guard<mutex> lock(channel->samplesMutex);
+    shared_ptr<const MeasureConfig> profile = atomic_load(&channel->config);
+
+    size_t count = channel->rawSamples.size();
+    vector<double> phases, temperatures, pressures, o2(count);
+    phases.reserve(count);
+    temperatures.reserve(count);
+    pressures.reserve(count);
+    for (const FiboxSample& sample : channel->rawSamples) {
+        phases.push_back(sample.phase);
+        temperatures.push_back(sample.temperature);
+        pressures.push_back(sample.pressure);
+    }
+
+    OxygenCalculation::computeBatch(*profile, phases.data(), temperatures.data(), pressures.data(), o2.data(), count);
+
+    channel->o2Array.clear();
+    auto sample = channel->rawSamples.begin();
+    for (size_t i = 0; i < count; i++) {
+        float value = (float)o2[i];
+        if (isnanf(value) || isinff(value)) {
+            sample = channel->rawSamples.erase(sample);
+        } else {
+            channel->o2Array.push_back(value);
+            sample->profileVersion = profile->version;
+            sample++;
+        }
     }
+    generation++;
 }
 
 void MeasureModule::addLuminositySample(float luminosity)
 {
     luminosityArray.push_front(luminosity);
+    luminosityStats.add(luminosity);
     if (luminosityArray.size() > NB_OF_SAMPLE * NB_LUMINOSITY_SENSOR) {
         luminosityArray.pop_back();
     }
+    generation++;
 }
 
 float MeasureModule::pressureAtSeaLevel(float temperature, float pressure, float altitude)
@@ -372,16 +454,86 @@ bool MeasureModule::isInitialising() const
     return this->initialising;
 }
 
-MeasureModule::MeasureModule()
+bool MeasureModule::isStopped() const
+{
+    return this->stopped;
+}
+
+UInt MeasureModule::getGeneration() const
+{
+    return this->generation;
+}
+
+vector<FiboxLinkStats> MeasureModule::getFiboxLinkStats()
+{
+    vector<FiboxLinkStats> stats;
+    for (FiboxChannel* channel : getFiboxChannels()) {
+        stats.push_back(channel->driver->getLinkStats());
+    }
+    return stats;
+}
+
+vector<FiboxChannel*> MeasureModule::getFiboxChannels()
+{
+    lock_guard<mutex> lock(fiboxChannelsMutex);
+
+    vector<FiboxChannel*> channels;
+    for (const auto& pair : fiboxChannels) {
+        channels.push_back(pair.second);
+    }
+    return channels;
+}
+
+vector<FiboxChannel*> MeasureModule::getFiboxChannels(String serial)
+{
+    if (serial.empty()) {
+        return getFiboxChannels();
+    }
+
+    lock_guard<mutex> lock(fiboxChannelsMutex);
+
+    vector<FiboxChannel*> channels;
+    auto it = fiboxChannels.find(serial);
+    if (it != fiboxChannels.end()) {
+        channels.push_back(it->second);
+    }
+    return channels;
+}
+
+void MeasureModule::addFiboxChannel(FiboxDriver* driver)
+{
+    FiboxChannel* channel = new FiboxChannel();
+    channel->driver = driver;
+
+    // The new probe starts with the module calibration
+    channel->config = atomic_load(&this->config);
+    channel->oxyCalculator = new OxygenCalculation(channel->config.get());
+    driver->setEnableTempFibox(channel->config->enableTempFibox);
+
+    {
+        lock_guard<mutex> lock(fiboxChannelsMutex);
+        fiboxChannels[driver->getSerial()] = channel;
+    }
+    generation++;
+
+    thread t(&MeasureModule::fiboxMeasureClock, this, channel);
+    t.detach();
+}
+
+MeasureModule::MeasureModule(EventLoop* loop) : fiboxBus(loop)
 {
     this->stc31Driver = STC31Driver();
     this->shtc3Driver = SHTC3Driver();
     this->lightSensorDriver = GroveLightSensorDriver();
-    this->fiboxDriver = FiboxDriver();
 
     // init default config
-    this->config = new MeasureConfig();
-    oxyCalculator = new OxygenCalculation(config);
+    this->lastProfileVersion = 0;
+    this->generation = 0;
+    this->resetRunning = false;
+    this->config = publishProfile(MeasureConfig());
+
+    // a channel (and its measure clock) is created for each Fibox found
+    fiboxBus.setNewDriverListener([this](FiboxDriver* driver) { addFiboxChannel(driver); });
 
     reset();
 
@@ -397,20 +549,56 @@ MeasureModule::MeasureModule()
     thread t4(&MeasureModule::lightSensorMeasureClock, this);
     t4.detach();
 
-    thread t5(&MeasureModule::fiboxMeasureClock, this);
-    t5.detach();
-
     thread t6(&MeasureModule::stc31CalibrationClock, this);
     t6.detach();
 }
 
-void MeasureModule::reset()
+void MeasureModule::reset(ResetHandler handler)
 {
-    thread t(&MeasureModule::processReset, this);
+    {
+        lock_guard<mutex> lock(resetMutex);
+        if (handler) {
+            resetHandlers.push_back(handler);
+        }
+        // The reset in progress calls the handler
+        if (resetRunning) {
+            return;
+        }
+        resetRunning = true;
+    }
+
+    thread t([this]() {
+        ResetReport report = processReset();
+
+        vector<ResetHandler> handlers;
+        {
+            lock_guard<mutex> lock(resetMutex);
+            handlers.swap(resetHandlers);
+            resetRunning = false;
+        }
+        for (ResetHandler& handler : handlers) {
+            handler(report);
+        }
+    });
     t.detach();
 }
 
-void MeasureModule::processReset()
+void MeasureModule::addInitResult(ResetReport& report, String sensor, chrono::steady_clock::time_point& start, bool success, String error)
+{
+    chrono::steady_clock::time_point now = chrono::steady_clock::now();
+    long durationMs = chrono::duration_cast<chrono::milliseconds>(now - start).count();
+    report.sensors.push_back(SensorInitResult{ sensor, success, durationMs, error });
+    start = now;
+}
+
+ResetReport MeasureModule::failReset(ResetReport& report, String sensor, chrono::steady_clock::time_point& start)
+{
+    addInitResult(report, sensor, start, false, errorArray.front().message);
+    this->initialising = false;
+    return report;
+}
+
+ResetReport MeasureModule::processReset()
 {
     this->stopped = true;
     this->initialising = true;
@@ -419,8 +607,21 @@ void MeasureModule::processReset()
     this->humidityArray.clear();
     this->luminosityArray.clear();
     this->co2Array.clear();
-    this->o2Array.clear();
+    for (FiboxChannel* channel : getFiboxChannels()) {
+        clearO2Samples(channel);
+        channel->o2Stats.clear();
+    }
     this->pressureArray.clear();
+    this->temperatureStats.clear();
+    this->humidityStats.clear();
+    this->pressureStats.clear();
+    this->co2Stats.clear();
+    this->luminosityStats.clear();
+    generation++;
+
+    ResetReport report;
+    report.success = false;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
 
     int16_t error = 0;
 
@@ -429,8 +630,7 @@ void MeasureModule::processReset()
     error = stc31Driver.sensirion_i2c_hal_init();
     if (error) {
         errorArray.push_front(DriverError("Impossible d'initialiser la communication avec le capteur STC31. La fonction [sensirion_i2c_hal_init] a retourné le code d'erreur : " + to_string(error)));
-        this->initialising = false;
-        return;
+        return failReset(report, "STC31", start);
     }
 
     UShort self_test_output;
@@ -439,8 +639,7 @@ void MeasureModule::processReset()
     this->stc31DriverMutex.unlock();
     if (error) {
         errorArray.push_front(DriverError("L'auto-test du capteur STC31 a échoué. La fonction [stc3x_self_test] a retourné le code d'erreur : " + to_string(error)));
-        this->initialising = false;
-        return;
+        return failReset(report, "STC31", start);
     }
 
     this->stc31DriverMutex.lock();
@@ -448,17 +647,16 @@ void MeasureModule::processReset()
     this->stc31DriverMutex.unlock();
     if (error) {
         errorArray.push_front(DriverError("La défénition du mode de relève du co2 a échoué. La fonction [stc3x_set_binary_gas] a retourné le code d'erreur : " + to_string(error)));
-        this->initialising = false;
-        return;
+        return failReset(report, "STC31", start);
     }
+    addInitResult(report, "STC31", start, true);
 
     /* SHTC3 init */
     shtc3Driver.sensirion_i2c_hal_free();
     error = shtc3Driver.sensirion_i2c_hal_init();
     if (error) {
         errorArray.push_front(DriverError("Impossible d'initialiser la communication avec le capteur SHTC3. La fonction [sensirion_i2c_hal_init] a retourné le code d'erreur : " + to_string(error)));
-        this->initialising = false;
-        return;
+        return failReset(report, "SHTC3", start);
     }
 
     int timeout = 0;
@@ -469,17 +667,16 @@ void MeasureModule::processReset()
     }
     if (timeout > 30) {
 		errorArray.push_front(DriverError("Impossible de communiquer avec le capteur SHTC3. La fonction [shtc1_probe] n'a pas retourné de réponse positive dans le temps imparti."));
-		this->initialising = false;
-		return;
+		return failReset(report, "SHTC3", start);
 	}
+    addInitResult(report, "SHTC3", start, true);
 
     /* BME680 init */
     BME68XCommon::i2c_hal_free();
     error = BME68XCommon::i2c_hal_init();
     if (error) {
         errorArray.push_front(DriverError("Impossible d'initialiser la communication avec le capteur BME680. La fonction [i2c_hal_init] a retourné le code d'erreur : " + to_string(error)));
-        this->initialising = false;
-        return;
+        return failReset(report, "BME680", start);
     }
 
     error = BME68XCommon::bme680_self_test();
@@ -488,6 +685,10 @@ void MeasureModule::processReset()
         // IGNORE ERROR: SELF TEST CAN CAUSE ERROR BUT VALUES ARE OK (JUST FOR PRESSURE)
         /*this->initialising = false;
         return;*/
+        addInitResult(report, "BME680", start, true, errorArray.front().message);
+    }
+    else {
+        addInitResult(report, "BME680", start, true);
     }
 
     /* Grove Light Sensor v1.2 ADC init */
@@ -495,45 +696,53 @@ void MeasureModule::processReset()
     error = lightSensorDriver.sensirion_i2c_hal_init();
     if (error) {
         errorArray.push_front(DriverError("Impossible d'initialiser la communication avec le capteur de lumière. La fonction [sensirion_i2c_hal_init] a retourné le code d'erreur : " + to_string(error)));
-        this->initialising = false;
-        return;
+        return failReset(report, "luminosity", start);
     }
 
     error = lightSensorDriver.initAddress();
     if (error) {
         errorArray.push_front(DriverError("Impossible d'initialiser la communication avec le capteur de lumière. La fonction [initAddress] a retourné le code d'erreur : " + to_string(error)));
-        this->initialising = false;
-        return;
+        return failReset(report, "luminosity", start);
     }
+    addInitResult(report, "luminosity", start, true);
 
     /* Fibox init */
+    String fibox = "Fibox";
     try
     {
-        fiboxDriver.initFiboxCommunication();
+        for (FiboxDriver* driver : fiboxBus.discover()) {
+            fibox = "Fibox " + driver->getSerial();
+            driver->initFiboxCommunication();
+            addInitResult(report, fibox, start, true);
+        }
     }
     catch (const DriverError e)
     {
         errorArray.push_front(e);
-        this->initialising = false;
-        return;
+        return failReset(report, fibox, start);
     }
 
     this->stopped = false;
     this->initialising = false;
+    report.success = true;
+    return report;
 }
 
-SensorMeasure* MeasureModule::get()
+SensorMeasure* MeasureModule::get(bool reportErrors)
 {
     if (stopped || initialising) {
         return nullptr;
     }
 
+    // errors of the series without enough data
+    list<DriverError> errors;
+
     float temperature = __FLT_MIN__;
     try {
         temperature = getAverage(temperatureArray);
     } catch (const DriverError& e) {
         String err_msg = e.message + " Série concernée : température.";
-        errorArray.push_front(DriverError(err_msg));
+        errors.push_front(DriverError(err_msg));
     }
 
     float humidity = __FLT_MIN__;
@@ -541,7 +750,7 @@ SensorMeasure* MeasureModule::get()
         humidity = getAverage(humidityArray);
     } catch (const DriverError& e) {
         String err_msg = e.message + " Série concernée : humidité.";
-        errorArray.push_front(DriverError(err_msg));
+        errors.push_front(DriverError(err_msg));
     }
 
     float pressure = __FLT_MIN__;
@@ -549,10 +758,10 @@ SensorMeasure* MeasureModule::get()
         pressure = getAverage(pressureArray);
 
         // convert to pressure at altitude to pressure at sea level
-        pressure = pressureAtSeaLevel(temperature, pressure, this->config->altitude);
+        pressure = pressureAtSeaLevel(temperature, pressure, atomic_load(&this->config)->altitude);
     } catch (const DriverError& e) {
         String err_msg = e.message + " Série concernée : pression.";
-        errorArray.push_front(DriverError(err_msg));
+        errors.push_front(DriverError(err_msg));
     }
 
     float co2 = __FLT_MIN__;
@@ -560,15 +769,30 @@ SensorMeasure* MeasureModule::get()
         co2 = getAverage(co2Array);
     } catch (const DriverError& e) {
         String err_msg = e.message + " Série concernée : CO2.";
-        errorArray.push_front(DriverError(err_msg));
+        errors.push_front(DriverError(err_msg));
     }
 
+    // "O2" is the main probe (first serial number), each probe is also given by serial number
     float o2 = __FLT_MIN__;
-    try {
-        o2 = getAverage(o2Array);
-    } catch (const DriverError& e) {
-        String err_msg = e.message + " Série concernée : o2.";
-        errorArray.push_front(DriverError(err_msg));
+    map<String, float> o2Probes;
+    vector<FiboxChannel*> channels = getFiboxChannels();
+    for (FiboxChannel* channel : channels) {
+        float probeO2 = __FLT_MIN__;
+        try {
+            lock_guard<mutex> lock(channel->samplesMutex);
+            probeO2 = getAverage(channel->o2Array);
+        } catch (const DriverError& e) {
+            if (channel == channels.front()) {
+                String err_msg = e.message + " Série concernée : o2.";
+                errors.push_front(DriverError(err_msg));
+            }
+        }
+        o2Probes[channel->driver->getSerial()] = probeO2;
+    }
+    if (channels.empty()) {
+        errors.push_front(DriverError("Aucun Fibox n'a été détecté. Série concernée : o2."));
+    } else {
+        o2 = o2Probes[channels.front()->driver->getSerial()];
     }
 
     float luminosity = __FLT_MIN__;
@@ -576,18 +800,175 @@ SensorMeasure* MeasureModule::get()
         luminosity = getAverage(luminosityArray);
     } catch (const DriverError& e) {
         String err_msg = e.message + " Série concernée : luminosité.";
-        errorArray.push_front(DriverError(err_msg));
+        errors.push_front(DriverError(err_msg));
+    }
+
+    if (reportErrors) {
+        errorArray.splice(errorArray.begin(), errors);
+    }
+
+    SensorMeasure* measure = new SensorMeasure(temperature, humidity, pressure, co2, o2, luminosity);
+    measure->setO2Probes(o2Probes);
+    return measure;
+}
+
+bool MeasureModule::setConfig(int altitude, double F1, double M, double DPHI1, double DPHI2, double DKSV1, double DKSV2, double pressure, double cal0, double cal2nd, double t0, double t2nd, double o2Cal2nd, bool calibIsHumid, bool enableTempFibox, bool humidMode, String serial)
+{
+    vector<FiboxChannel*> channels = getFiboxChannels(serial);
+    if (!serial.empty() && channels.empty()) {
+        return false;
     }
 
-    return new SensorMeasure(temperature, humidity, pressure, co2, o2, luminosity);
+    shared_ptr<const MeasureConfig> current = atomic_load(&this->config);
+    bool altitudeChanged = current->altitude != altitude;
+
+    MeasureConfig calibration = *current;
+    calibration.set(altitude, F1, M, DPHI1, DPHI2, DKSV1, DKSV2, pressure, cal0, cal2nd, t0, t2nd, o2Cal2nd, calibIsHumid, enableTempFibox, humidMode);
+    shared_ptr<const MeasureConfig> profile = publishProfile(calibration);
+
+    if (serial.empty()) {
+        // default calibration for all the probes, including the ones discovered later
+        atomic_store(&this->config, profile);
+    } else {
+        MeasureConfig module = *current;
+        module.altitude = altitude;
+        atomic_store(&this->config, publishProfile(module));
+    }
+
+    for (FiboxChannel* channel : channels) {
+        // recalculate parameters dependant data with the new calibration
+        applyProfile(channel, profile);
+    }
+
+    // the co2 is compensated by the STC31 itself (with the pressure at sea level), it can not be recalculated
+    if (altitudeChanged) {
+        co2Array.clear();
+    }
+    generation++;
+
+    return true;
+}
+
+bool MeasureModule::getStats(SensorMeasure::Channel channel, String serial, int window, WindowStats::Result& result)
+{
+    switch (channel) {
+    case SensorMeasure::CO2:
+        result = co2Stats.get(window);
+        return true;
+    case SensorMeasure::TEMPERATURE:
+        result = temperatureStats.get(window);
+        return true;
+    case SensorMeasure::HUMIDITY:
+        result = humidityStats.get(window);
+        return true;
+    case SensorMeasure::PRESSURE:
+        result = pressureStats.get(window);
+        return true;
+    case SensorMeasure::LUMINOSITY:
+        result = luminosityStats.get(window);
+        return true;
+    case SensorMeasure::O2: {
+        // without serial number, the main probe is the first one
+        vector<FiboxChannel*> channels = getFiboxChannels(serial);
+        if (channels.empty()) {
+            return false;
+        }
+        result = channels.front()->o2Stats.get(window);
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+shared_ptr<const MeasureConfig> MeasureModule::getConfig(String serial)
+{
+    if (serial.empty()) {
+        return atomic_load(&this->config);
+    }
+
+    vector<FiboxChannel*> channels = getFiboxChannels(serial);
+    if (channels.empty()) {
+        return nullptr;
+    }
+    return atomic_load(&channels.front()->config);
+}
+
+bool MeasureModule::saveProfile(String name, String serial)
+{
+    shared_ptr<const MeasureConfig> profile = getConfig(serial);
+    if (profile == nullptr) {
+        return false;
+    }
+
+    lock_guard<mutex> lock(profilesMutex);
+    profiles[name] = profile;
+    return true;
+}
+
+void MeasureModule::loadProfile(String name, String serial)
+{
+    shared_ptr<const MeasureConfig> saved;
+    {
+        lock_guard<mutex> lock(profilesMutex);
+        auto it = profiles.find(name);
+        if (it == profiles.end()) {
+            throw DriverError("Le profil de calibration " + name + " n'existe pas.");
+        }
+        saved = it->second;
+    }
+
+    vector<FiboxChannel*> channels = getFiboxChannels(serial);
+    if (!serial.empty() && channels.empty()) {
+        throw DriverError("Aucun Fibox ne correspond au numéro de série donné.");
+    }
+
+    // the altitude and the calculation mode are not part of the calibration: the module ones are kept
+    shared_ptr<const MeasureConfig> current = atomic_load(&this->config);
+    shared_ptr<const MeasureConfig> profile = saved;
+    if (saved->altitude != current->altitude || saved->fastMath != current->fastMath) {
+        MeasureConfig calibration = *saved;
+        calibration.altitude = current->altitude;
+        calibration.fastMath = current->fastMath;
+        profile = publishProfile(calibration);
+    }
+
+    if (serial.empty()) {
+        atomic_store(&this->config, profile);
+    }
+    for (FiboxChannel* channel : channels) {
+        applyProfile(channel, profile);
+    }
+}
+
+void MeasureModule::setFastMath(bool enable)
+{
+    MeasureConfig module = *atomic_load(&this->config);
+    module.fastMath = enable;
+    atomic_store(&this->config, publishProfile(module));
+
+    for (FiboxChannel* channel : getFiboxChannels()) {
+        MeasureConfig calibration = *atomic_load(&channel->config);
+        calibration.fastMath = enable;
+        applyProfile(channel, publishProfile(calibration));
+    }
+}
+
+shared_ptr<const MeasureConfig> MeasureModule::publishProfile(const MeasureConfig& config)
+{
+    MeasureConfig* profile = new MeasureConfig(config);
+
+    lock_guard<mutex> lock(profilesMutex);
+    profile->version = ++this->lastProfileVersion;
+    return shared_ptr<const MeasureConfig>(profile);
 }
 
-void MeasureModule::setConfig(int altitude, double F1, double M, double DPHI1, double DPHI2, double DKSV1, double DKSV2, double pressure, double cal0, double cal2nd, double t0, double t2nd, double o2Cal2nd, bool calibIsHumid, bool humidMode, bool enableTempFibox)
+void MeasureModule::applyProfile(FiboxChannel* channel, shared_ptr<const MeasureConfig> profile)
 {
-    this->config->set(altitude, F1, M, DPHI1, DPHI2, DKSV1, DKSV2, pressure, cal0, cal2nd, t0, t2nd, o2Cal2nd, calibIsHumid, enableTempFibox, humidMode);
-    this->fiboxDriver.setEnableTempFibox(config->enableTempFibox);
+    atomic_store(&channel->config, profile);
+    channel->driver->setEnableTempFibox(profile->enableTempFibox);
+    recomputeO2Samples(channel);
 
-    // clear parameters dependant data
-    co2Array.clear();
-    o2Array.clear();
+    // the previous samples were computed with another calibration
+    channel->o2Stats.clear();
 }
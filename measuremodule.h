@@ -2,16 +2,26 @@
 #define MEASUREMODULE_H
 
 #include <list>
+#include <ctime>
 #include <thread>
 #include "drivererror.h"
 #include "sensormeasure.h"
 #include <mutex>
+#include <map>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <functional>
 
 #include "STC31-driver/stc31.h"
 #include "SHTC3-driver/shtc3.h"
 #include "LightSensor-driver/grovelightsensor.h"
 #include "Fibox-driver/FiboxDriver.h"
+#include "Fibox-driver/FiboxBus.h"
 #include "MeasureConfig.h"
+#include "windowstats.h"
+#include "eventloop.h"
 using namespace std;
 
 #define NB_TEMPERATURE_SENSOR 2
@@ -24,10 +34,85 @@ using namespace std;
 // Number of samples to average
 #define NB_OF_SAMPLE 10
 
+/**
+ * @brief The FiboxSample struct is the input of an o2 sample calculation.
+ * It is retained so the o2 window can be recomputed when the calibration changes.
+ */
+struct FiboxSample
+{
+    double phase;       // phase angle returned by the Fibox (degrees)
+    double temperature; // temperature used for the calculation (Celsius)
+    double pressure;    // pressure used for the calculation (Pa)
+    time_t timestamp;
+    UInt profileVersion; // version of the calibration profile the o2 sample has been computed with
+};
+
+/**
+ * @brief The FiboxChannel struct represents an oxygen probe (Fibox device) of the measure module.
+ * Each Fibox has its own driver, calibration and o2 samples.
+ */
+struct FiboxChannel
+{
+    FiboxDriver* driver;
+
+    /**
+     * @brief The calibration profile of this probe.
+     * It is immutable and swapped atomically (std::atomic_load/std::atomic_store), so a sample never sees a half-updated calibration.
+     */
+    shared_ptr<const MeasureConfig> config;
+
+    /**
+     * @brief The oxygen calculation object (only used by the measure clock of this probe).
+     */
+    OxygenCalculation* oxyCalculator;
+
+    list<float> o2Array;
+
+    /**
+     * @brief The inputs of the o2 samples, in the same order as o2Array.
+     */
+    list<FiboxSample> rawSamples;
+
+    /**
+     * @brief The mutex protecting o2Array and rawSamples.
+     */
+    mutex samplesMutex;
+
+    /**
+     * @brief The statistics of the o2 samples (cleared when the calibration changes).
+     */
+    WindowStats o2Stats;
+};
+
+/**
+ * @brief The SensorInitResult struct is the outcome of the initialisation of a sensor during a reset.
+ */
+struct SensorInitResult
+{
+    String sensor;   // name of the sensor (STC31, SHTC3, BME680, luminosity, Fibox <serial>)
+    bool success;
+    long durationMs;
+    String error;    // error message, also given for an ignored error (empty if none)
+};
+
+/**
+ * @brief The ResetReport struct is the outcome of a reset: the sensors are initialised in order until one fails.
+ */
+struct ResetReport
+{
+    bool success;
+    vector<SensorInitResult> sensors;
+};
+
 class MeasureModule
 {
     private:
-        list<float> temperatureArray, humidityArray, pressureArray, co2Array, o2Array, luminosityArray;
+        list<float> temperatureArray, humidityArray, pressureArray, co2Array, luminosityArray;
+
+        /**
+         * @brief The statistics of the samples over sliding windows (GET_STATS).
+         */
+        WindowStats temperatureStats, humidityStats, pressureStats, co2Stats, luminosityStats;
 
         /**
          * @brief Reads data from the STC31 sensor (co2 and temperature) each seconds.
@@ -54,10 +139,28 @@ class MeasureModule
         void lightSensorMeasureClock();
 
         /**
-         * @brief Reads data from the Fibox sensor (o2, temperature and pressure) each seconds.
+         * @brief Reads data from a Fibox sensor (o2, temperature and pressure) each seconds.
          * It stores the data in the corresponding arrays.
+         *
+         * @param channel The Fibox channel to read.
+         */
+        void fiboxMeasureClock(FiboxChannel* channel);
+
+        /**
+         * @brief Creates the channel of a new Fibox driver and starts its measure clock.
+         * Called by the Fibox bus when a new serial number is discovered (on RESET or hotplug).
+         *
+         * @param driver The new Fibox driver.
          */
-        void fiboxMeasureClock();
+        void addFiboxChannel(FiboxDriver* driver);
+
+        /**
+         * @brief Returns the Fibox channels, sorted by serial number.
+         * The first one is the main probe (reported as "O2" by GET_MEASURE).
+         *
+         * @return The Fibox channels.
+         */
+        vector<FiboxChannel*> getFiboxChannels();
 
         /**
          * @brief Calibrates the STC31 sensor each 5 seconds.
@@ -69,8 +172,31 @@ class MeasureModule
          * @brief Reset all the sensors.
          * It pauses the measure clocks and reset the data arrays.
          * It also initialise all the sensors.
+         *
+         * @return The outcome of the initialisation of each sensor.
          */
-        void processReset();
+        ResetReport processReset();
+
+        /**
+         * @brief Adds the outcome of the initialisation of a sensor to a reset report.
+         *
+         * @param report The reset report.
+         * @param sensor The name of the sensor.
+         * @param start The start of the initialisation of the sensor (set to now, for the next one).
+         * @param success True if the sensor is initialised.
+         * @param error The error message (empty if none).
+         */
+        void addInitResult(ResetReport& report, String sensor, chrono::steady_clock::time_point& start, bool success, String error = "");
+
+        /**
+         * @brief Ends a reset after the failure of the initialisation of a sensor (the error is the last one added to the errors list).
+         *
+         * @param report The reset report.
+         * @param sensor The name of the sensor.
+         * @param start The start of the initialisation of the sensor.
+         * @return The reset report.
+         */
+        ResetReport failReset(ResetReport& report, String sensor, chrono::steady_clock::time_point& start);
 
         /**
          * @brief The list of errors that occurred in the driver.
@@ -110,12 +236,53 @@ class MeasureModule
         void addCo2Sample(float);
 
         /**
-         * @brief Adds a o2 sample to the corresponding array.
+         * @brief Adds a o2 sample to the array of a Fibox channel.
          * It also removes the oldest sample if the array is full.
          * 
+         * @param channel The Fibox channel.
          * @param sample The o2 sample to add.
+         * @param input The inputs used to calculate the sample.
+         */
+        void addO2Sample(FiboxChannel*, float, FiboxSample);
+
+        /**
+         * @brief Removes the o2 samples (and their inputs) of a Fibox channel.
+         *
+         * @param channel The Fibox channel.
+         */
+        void clearO2Samples(FiboxChannel*);
+
+        /**
+         * @brief Recomputes the o2 samples of a Fibox channel from their inputs with the current calibration.
+         * The samples giving an invalid value with the new calibration are dropped.
+         *
+         * @param channel The Fibox channel.
+         */
+        void recomputeO2Samples(FiboxChannel*);
+
+        /**
+         * @brief Publishes a configuration as a new immutable profile version.
+         *
+         * @param config The configuration.
+         * @return The published profile.
          */
-        void addO2Sample(float);
+        shared_ptr<const MeasureConfig> publishProfile(const MeasureConfig& config);
+
+        /**
+         * @brief Swaps the calibration profile of a Fibox channel and recomputes its o2 window.
+         *
+         * @param channel The Fibox channel.
+         * @param profile The new calibration profile.
+         */
+        void applyProfile(FiboxChannel*, shared_ptr<const MeasureConfig> profile);
+
+        /**
+         * @brief Returns the Fibox channels matching a serial number.
+         *
+         * @param serial The serial number, empty for all the channels.
+         * @return The matching channels (empty if no Fibox has this serial number).
+         */
+        vector<FiboxChannel*> getFiboxChannels(String serial);
 
         /**
          * @brief Adds a luminosity sample to the corresponding array.
@@ -156,6 +323,21 @@ class MeasureModule
          */
         bool initialising;
 
+        /**
+         * @brief True while a reset thread runs (the boot one or one asked by a client).
+         */
+        bool resetRunning;
+
+        /**
+         * @brief The handlers called with the outcome of the reset in progress.
+         */
+        vector<function<void(const ResetReport& report)>> resetHandlers;
+
+        /**
+         * @brief The mutex protecting resetRunning and resetHandlers.
+         */
+        mutex resetMutex;
+
         /**
          * @brief The mutex used to protect the STC31 snsor.
          * It prevents the STC31 sensor to be used by multiple threads at the same time (calibration and measure clocks).
@@ -165,37 +347,80 @@ class MeasureModule
         STC31Driver stc31Driver;
         SHTC3Driver shtc3Driver;
         GroveLightSensorDriver lightSensorDriver;
-        FiboxDriver fiboxDriver;
+
+        /**
+         * @brief The Fibox bus (shared libusb context and hotplug detection of the Fibox devices).
+         */
+        FiboxBus fiboxBus;
+
+        /**
+         * @brief The Fibox channels (key: USB serial number of the Fibox).
+         */
+        map<String, FiboxChannel*> fiboxChannels;
+
+        /**
+         * @brief The mutex protecting the Fibox channels map.
+         */
+        mutex fiboxChannelsMutex;
 
         /**
          * @brief The configuration object used to recalculate and correct measurements.
+         * It is the module configuration (altitude) and the default calibration given to the new Fibox channels.
+         * Like the channels profiles, it is immutable and swapped atomically.
+         */
+        shared_ptr<const MeasureConfig> config;
+
+        /**
+         * @brief The named calibration profiles (saved by SAVE_PROFILE).
          */
-        MeasureConfig* config;
+        map<String, shared_ptr<const MeasureConfig>> profiles;
 
         /**
-         * @brief The oxygen calculation object used to calculate the oxygen level from the raw Fibox values.
+         * @brief The mutex protecting the named profiles and the publication of new profiles.
          */
-        OxygenCalculation* oxyCalculator;
+        mutex profilesMutex;
+
+        /**
+         * @brief The last published profile version.
+         */
+        UInt lastProfileVersion;
+
+        /**
+         * @brief The generation of the samples (see getGeneration).
+         */
+        atomic<UInt> generation;
 
     public:
         /**
          * @brief Constructs a new MeasureModule object.
          * It initialises all the sensors and starts the measure and calibration clocks.
+         *
+         * @param loop The daemon's event loop (used by the Fibox driver for the USB events).
          */
-        MeasureModule();
+        MeasureModule(EventLoop* loop);
+
+        /**
+         * @brief Handler called with the outcome of a reset (on the reset thread).
+         */
+        typedef function<void(const ResetReport& report)> ResetHandler;
 
         /**
          * @brief Launch the reset function in a new thread.
+         * If a reset is already in progress (e.g. the one started at boot), no other reset is started:
+         * the handler is called with the outcome of the reset in progress.
+         *
+         * @param handler The handler called when the reset is done (nullptr if none).
          */
-        void reset();
+        void reset(ResetHandler handler = nullptr);
 
         /**
          * @brief Retrieves all the physical values from the sensors.
          * It calculates the average of the values.
          *
+         * @param reportErrors False to not add the errors of the series without enough data to the errors list (periodic snapshots).
          * @return The SensorMeasure object containing all the average physical values.
          */
-        SensorMeasure* get();
+        SensorMeasure* get(bool reportErrors = true);
 
         /**
         * @brief Sets the configuration of the measurement module.
@@ -216,9 +441,58 @@ class MeasureModule
         * @param calibIsHumid The calibIsHumid constant (true if the calibration data has been calculated in a humid environment).
         * @param enableTempFibox The enableTempFibox constant (true to use the temperature sensor of the Fibox device).
         * @param humidMode The humidMode constant (true if measurements are realised in humid environment).
+        * @param serial The serial number of the Fibox to calibrate, empty to calibrate all of them (and the ones discovered later).
+        * @return False if no Fibox has the given serial number.
         */
-        void setConfig(int altitude, double F1, double M, double DPHI1, double DPHI2, double DKSV1, double DKSV2, double pressure, double cal0, double cal2nd, double t0, double t2nd, double o2Cal2nd, bool calibIsHumid, bool enableTempFibox, bool humidMode);
+        bool setConfig(int altitude, double F1, double M, double DPHI1, double DPHI2, double DKSV1, double DKSV2, double pressure, double cal0, double cal2nd, double t0, double t2nd, double o2Cal2nd, bool calibIsHumid, bool enableTempFibox, bool humidMode, String serial = "");
         
+        /**
+         * @brief Gets the statistics of the samples of a measure over a sliding window.
+         * The pressure is the one measured by the sensors (not converted to sea level).
+         *
+         * @param channel The measure (O2_PROBES is not a single measure).
+         * @param serial For O2, the serial number of the Fibox, empty for the main probe.
+         * @param window The index of the window (see WindowStats::getWindow).
+         * @param result The statistics.
+         * @return False if the measure has no statistics or if no Fibox has the given serial number.
+         */
+        bool getStats(SensorMeasure::Channel channel, String serial, int window, WindowStats::Result& result);
+
+        /**
+         * @brief Gets the current calibration of a Fibox probe.
+         *
+         * @param serial The serial number of the Fibox, empty for the default calibration.
+         * @return The calibration (immutable profile), nullptr if no Fibox has the given serial number.
+         */
+        shared_ptr<const MeasureConfig> getConfig(String serial = "");
+
+        /**
+         * @brief Saves the current calibration of a Fibox probe as a named profile.
+         *
+         * @param name The name of the profile (an existing profile is replaced).
+         * @param serial The serial number of the Fibox, empty for the default calibration.
+         * @return False if no Fibox has the given serial number.
+         */
+        bool saveProfile(String name, String serial = "");
+
+        /**
+         * @brief Switches the calibration of the Fibox probes to a named profile.
+         * The o2 windows are recomputed with the profile instead of being cleared.
+         *
+         * @param name The name of the profile.
+         * @param serial The serial number of the Fibox, empty to switch all of them (and the ones discovered later).
+         * @throw DriverError If the profile does not exist or if no Fibox has the given serial number.
+         */
+        void loadProfile(String name, String serial = "");
+
+        /**
+         * @brief Selects the exact (libm) or the approximated (FastMath) oxygen calculation for all the Fibox probes.
+         * The o2 windows are recomputed with the selected functions.
+         *
+         * @param enable True to use the approximated functions.
+         */
+        void setFastMath(bool enable);
+
         /**
          * @brief Retrieves the list of errors that occurred in the driver.
          *
@@ -232,6 +506,28 @@ class MeasureModule
          * @return True if the measure module is initialising.
          */
         bool isInitialising() const;
+
+        /**
+         * @brief Returns if the measure module is stopped (after a sensor error, until RESET).
+         *
+         * @return True if the measure module is stopped.
+         */
+        bool isStopped() const;
+
+        /**
+         * @brief Returns the generation of the samples: it changes each time a sample is added or removed,
+         * or when the configuration changes, so an unchanged generation means that get() gives the same measure.
+         *
+         * @return The generation of the samples.
+         */
+        UInt getGeneration() const;
+
+        /**
+         * @brief Returns the state of the USB link with each Fibox device.
+         *
+         * @return The link states and the hotplug re-attachment metrics, sorted by serial number.
+         */
+        vector<FiboxLinkStats> getFiboxLinkStats();
 };
 
 #endif // MEASUREMODULE_H
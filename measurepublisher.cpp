@@ -0,0 +1,239 @@
+#include "measurepublisher.h"
+#include "TcpMessages/TcpAnswer.h"
+#include "TcpMessages/BinaryFrame.h"
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <chrono>
+#include <cmath>
+
+static_assert(SensorMeasure::CHANNEL_COUNT == MEASURE_SNAPSHOT_CHANNEL_COUNT && SensorMeasure::O2_PROBES == MEASURE_SNAPSHOT_O2_PROBES_CHANNEL,
+    "The shared memory layout must follow the SensorMeasure channels.");
+
+MeasurePublisher::MeasurePublisher(EventLoop* loop, TcpServer* server, MeasureModule* module)
+{
+    this->loop = loop;
+    this->server = server;
+    this->module = module;
+    this->timer = loop->addTimer([this]() { publish(); });
+    this->timerArmed = false;
+    this->multicastSocket = -1;
+    this->multicastAddress = {};
+    this->multicastSequence = 0;
+    this->snapshotSegment = nullptr;
+
+    server->addCloseHandler([this](int connection) { unsubscribe(connection); });
+}
+
+void MeasurePublisher::subscribe(int connection, String requestId, vector<String> channels, int interval)
+{
+    subscriptions[connection] = Subscription{ requestId, channels, interval, 0, "" };
+    updateTimer();
+}
+
+bool MeasurePublisher::unsubscribe(int connection)
+{
+    if (subscriptions.erase(connection) == 0) {
+        return false;
+    }
+
+    updateTimer();
+    return true;
+}
+
+void MeasurePublisher::startMulticast(String group, int port)
+{
+    struct sockaddr_in address {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    if (inet_pton(AF_INET, group.c_str(), &address.sin_addr) != 1 || !IN_MULTICAST(ntohl(address.sin_addr.s_addr)) || port <= 0 || port > 65535) {
+        throw DriverError("L'adresse " + group + ":" + to_string(port) + " n'est pas une adresse de multicast valide.");
+    }
+
+    int udpSocket = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (udpSocket < 0) {
+        throw DriverError("Impossible de créer le socket UDP de multicast.");
+    }
+
+    // Local network only, and the local listeners receive the snapshots too
+    unsigned char ttl = 1;
+    unsigned char loopback = 1;
+    setsockopt(udpSocket, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+    setsockopt(udpSocket, IPPROTO_IP, IP_MULTICAST_LOOP, &loopback, sizeof(loopback));
+
+    stopMulticast();
+    multicastSocket = udpSocket;
+    multicastAddress = address;
+    updateTimer();
+}
+
+void MeasurePublisher::stopMulticast()
+{
+    if (multicastSocket >= 0) {
+        close(multicastSocket);
+        multicastSocket = -1;
+    }
+    updateTimer();
+}
+
+void MeasurePublisher::startSharedMemory(String name)
+{
+    int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0640);
+    if (fd < 0) {
+        throw DriverError("Impossible de créer le segment de mémoire partagée " + name + ".");
+    }
+
+    // The readers of the daemon's group can map it (umask may have removed the group bit)
+    fchmod(fd, 0640);
+    if (ftruncate(fd, sizeof(MeasureSnapshotSegment)) < 0) {
+        close(fd);
+        shm_unlink(name.c_str());
+        throw DriverError("Impossible de dimensionner le segment de mémoire partagée " + name + ".");
+    }
+
+    void* address = mmap(nullptr, sizeof(MeasureSnapshotSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (address == MAP_FAILED) {
+        shm_unlink(name.c_str());
+        throw DriverError("Impossible de projeter le segment de mémoire partagée " + name + ".");
+    }
+
+    stopSharedMemory();
+
+    // The segment is zeroed by ftruncate: no snapshot yet (sequence 0), and the magic number is written last
+    MeasureSnapshotSegment* segment = (MeasureSnapshotSegment*)address;
+    segment->version = MEASURE_SNAPSHOT_VERSION;
+    segment->channelCount = MEASURE_SNAPSHOT_CHANNEL_COUNT;
+    segment->size = sizeof(MeasureSnapshotSegment);
+    for (UInt channel = 0; channel < MEASURE_SNAPSHOT_CHANNEL_COUNT; channel++) {
+        segment->data.values[channel] = NAN;
+    }
+    segment->magic.store(MEASURE_SNAPSHOT_MAGIC, memory_order_release);
+
+    snapshotSegment = segment;
+    snapshotSegmentName = name;
+    updateTimer();
+}
+
+void MeasurePublisher::stopSharedMemory()
+{
+    if (snapshotSegment != nullptr) {
+        munmap(snapshotSegment, sizeof(MeasureSnapshotSegment));
+        shm_unlink(snapshotSegmentName.c_str());
+        snapshotSegment = nullptr;
+    }
+    updateTimer();
+}
+
+void MeasurePublisher::writeSharedMemory(SensorMeasure* measure)
+{
+    MeasureSnapshotData& data = snapshotSegment->data;
+    int64_t timestamp = chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch()).count();
+
+    // Seqlock: odd while writing, the readers retry if the counter is odd or changed during their copy
+    uint32_t seqlock = snapshotSegment->seqlock.load(memory_order_relaxed);
+    snapshotSegment->seqlock.store(seqlock + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    data.sequence++;
+    data.timestamp = timestamp;
+    data.validMask = 0;
+    for (UInt channel = 0; channel < SensorMeasure::CHANNEL_COUNT; channel++) {
+        if (channel == SensorMeasure::O2_PROBES) {
+            continue;
+        }
+
+        // An unavailable value keeps the last available one and its timestamp
+        float value = measure->getValue((SensorMeasure::Channel)channel);
+        if (value != __FLT_MIN__) {
+            data.values[channel] = value;
+            data.timestamps[channel] = timestamp;
+            data.validMask |= 1U << channel;
+        }
+    }
+
+    const map<String, float>& probes = measure->getO2ProbesValues();
+    data.probeCount = 0;
+    for (const auto& pair : probes) {
+        if (data.probeCount == MEASURE_SNAPSHOT_MAX_PROBES) {
+            break;
+        }
+
+        MeasureSnapshotProbe& probe = data.probes[data.probeCount++];
+        memset(probe.serial, 0, sizeof(probe.serial));
+        pair.first.copy(probe.serial, sizeof(probe.serial) - 1);
+        probe.value = pair.second == __FLT_MIN__ ? NAN : pair.second;
+    }
+    if (data.probeCount > 0) {
+        data.timestamps[SensorMeasure::O2_PROBES] = timestamp;
+        data.validMask |= 1U << SensorMeasure::O2_PROBES;
+    }
+
+    snapshotSegment->seqlock.store(seqlock + 2, memory_order_release);
+}
+
+void MeasurePublisher::updateTimer()
+{
+    bool active = !subscriptions.empty() || multicastSocket >= 0 || snapshotSegment != nullptr;
+    if (active != timerArmed) {
+        loop->armTimer(timer, active ? MEASURE_PUBLISH_INTERVAL_US : 0);
+        timerArmed = active;
+    }
+}
+
+void MeasurePublisher::publish()
+{
+    // Same snapshot for all the subscribers, the errors are only reported to GET_MEASURE
+    SensorMeasure* measure = module->get(false);
+    if (measure != nullptr && snapshotSegment != nullptr) {
+        writeSharedMemory(measure);
+    }
+    if (measure != nullptr && measure->isComplete()) {
+        time_t now = time(nullptr);
+
+        // One datagram for all the listeners of the group (a full socket buffer only loses this snapshot)
+        if (multicastSocket >= 0) {
+            String frame = BinaryFrame::encodeSnapshot(++multicastSequence, measure);
+            sendto(multicastSocket, frame.data(), frame.size(), 0, (struct sockaddr*)&multicastAddress, sizeof(multicastAddress));
+        }
+
+        vector<int> connections;
+        for (const auto& pair : subscriptions) {
+            connections.push_back(pair.first);
+        }
+
+        for (int connection : connections) {
+            auto it = subscriptions.find(connection);
+            if (it == subscriptions.end()) {
+                continue;
+            }
+            Subscription& subscription = it->second;
+
+            TcpAnswer answer(subscription.requestId);
+            answer.setMeasurementsData(measure, subscription.channels);
+
+            bool changed = answer.data != subscription.lastData;
+            bool due = subscription.interval > 0 ? now - subscription.lastSent >= subscription.interval : changed;
+            if (!due) {
+                continue;
+            }
+
+            subscription.lastSent = now;
+            subscription.lastData = answer.data;
+
+            // A failed push closes the connection, which ends the subscription
+            TcpProtocol protocol = server->getProtocol(connection);
+            if (protocol == TCP_PROTOCOL_TEXT) {
+                server->push(connection, answer.toString());
+            }
+            else {
+                UInt channels = TcpAnswer::getMeasurementChannelMask(subscription.channels);
+                server->push(connection, BinaryFrame::encodeMeasure(subscription.requestId, measure, channels, protocol == TCP_PROTOCOL_BINARY_FLOAT64));
+            }
+        }
+    }
+    delete measure;
+
+    timerArmed = false;
+    updateTimer();
+}
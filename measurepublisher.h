@@ -0,0 +1,151 @@
+#ifndef MEASUREPUBLISHER_H
+#define MEASUREPUBLISHER_H
+
+#include <map>
+#include <vector>
+#include <ctime>
+#include "types.h"
+#include "eventloop.h"
+#include "tcpserver.h"
+#include "measuremodule.h"
+#include "measuresnapshot.h"
+#include <netinet/in.h>
+using namespace std;
+
+// Interval between two snapshots of the measure module (the sensors are read each second)
+#define MEASURE_PUBLISH_INTERVAL_US 1000000
+
+/**
+ * @brief The MeasurePublisher class pushes the measure snapshots to the subscribed TCP clients (SUBSCRIBE command).
+ * It runs on the event loop: a snapshot is taken each second and sent to the subscribers whose interval
+ * is elapsed, or whose data changed for the "on change" subscriptions.
+ * Each snapshot can also be sent once to a UDP multicast group (MULTICAST command), as a numbered SNAPSHOT frame,
+ * and written to a POSIX shared memory segment read by the local clients without any request (see measuresnapshot.h).
+ */
+class MeasurePublisher
+{
+public:
+    /**
+     * @brief Constructs a new MeasurePublisher object.
+     *
+     * @param loop The event loop running the TCP server.
+     * @param server The TCP server of the subscribers (the subscriptions end with the connections).
+     * @param module The measure module.
+     */
+    MeasurePublisher(EventLoop* loop, TcpServer* server, MeasureModule* module);
+
+    /**
+     * @brief Subscribes a client connection to the measure snapshots (replaces its previous subscription).
+     *
+     * @param connection The id of the client connection.
+     * @param requestId The id of the SUBSCRIBE request (used as id of the pushed messages).
+     * @param channels The names of the measures to send, empty for all of them.
+     * @param interval The interval between two messages in seconds, 0 to send a message only when the data changes.
+     */
+    void subscribe(int connection, String requestId, vector<String> channels, int interval);
+
+    /**
+     * @brief Ends the subscription of a client connection.
+     *
+     * @param connection The id of the client connection.
+     * @return False if the connection had no subscription.
+     */
+    bool unsubscribe(int connection);
+
+    /**
+     * @brief Starts sending the snapshots to a UDP multicast group (replaces the previous group).
+     *
+     * @param group The IPv4 multicast group address.
+     * @param port The UDP port.
+     * @throw DriverError If the group is not a multicast address or if the socket could not be created.
+     */
+    void startMulticast(String group, int port);
+
+    /**
+     * @brief Stops sending the snapshots to the UDP multicast group.
+     */
+    void stopMulticast();
+
+    /**
+     * @brief Creates the shared memory segment and writes each snapshot to it (replaces the previous segment).
+     *
+     * @param name The name of the POSIX shared memory segment (starting with '/').
+     * @throw DriverError If the segment could not be created.
+     */
+    void startSharedMemory(String name);
+
+    /**
+     * @brief Stops writing the snapshots and removes the shared memory segment.
+     */
+    void stopSharedMemory();
+
+private:
+    /**
+     * @brief The Subscription struct is the subscription of a client connection.
+     */
+    struct Subscription
+    {
+        String requestId;
+        vector<String> channels;
+        int interval;
+        time_t lastSent;
+        String lastData;
+    };
+
+    /**
+     * @brief Takes a snapshot of the measure module and sends it to the subscribers and the multicast group.
+     * Called by the publish timer.
+     */
+    void publish();
+
+    /**
+     * @brief Arms or disarms the publish timer depending on the subscribers and the multicast group.
+     */
+    void updateTimer();
+
+    /**
+     * @brief Writes a snapshot to the shared memory segment (the incomplete ones too, with their validity bits).
+     *
+     * @param measure The snapshot.
+     */
+    void writeSharedMemory(SensorMeasure* measure);
+
+    EventLoop* loop;
+    TcpServer* server;
+    MeasureModule* module;
+
+    /**
+     * @brief The publish timer (armed while there are subscribers).
+     */
+    int timer;
+
+    /**
+     * @brief The subscriptions (key: client connection id).
+     * Only used from the event loop thread.
+     */
+    map<int, Subscription> subscriptions;
+
+    /**
+     * @brief The UDP socket sending the snapshots (-1 if the multicast is stopped) and the multicast group.
+     */
+    int multicastSocket;
+    struct sockaddr_in multicastAddress;
+
+    /**
+     * @brief The sequence number of the last snapshot sent to the multicast group.
+     */
+    UInt multicastSequence;
+
+    /**
+     * @brief The mapped shared memory segment (nullptr if not created) and its name.
+     */
+    MeasureSnapshotSegment* snapshotSegment;
+    String snapshotSegmentName;
+
+    /**
+     * @brief True if the publish timer is armed.
+     */
+    bool timerArmed;
+};
+
+#endif // MEASUREPUBLISHER_H
@@ -0,0 +1,180 @@
+#ifndef MEASURESNAPSHOT_H
+#define MEASURESNAPSHOT_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+ * Layout of the POSIX shared memory segment holding the latest measure snapshot, and its reader.
+ * This header is standalone (no dependency on the daemon sources) so that the local clients can include it as is.
+ * The daemon writes the segment each time it takes a snapshot (each second), the readers only load memory:
+ * the data is protected by a seqlock (odd counter while the daemon writes, the reader retries if the counter changed).
+ */
+
+// Default name of the segment (/dev/shm/daemon_drivers)
+#define MEASURE_SNAPSHOT_SEGMENT_NAME "/daemon_drivers"
+
+// "MSNP", written last when the segment is initialized
+#define MEASURE_SNAPSHOT_MAGIC 0x504E534D
+#define MEASURE_SNAPSHOT_VERSION 1
+
+// Same order as SensorMeasure::Channel: CO2, TEMPERATURE, HUMIDITY, PRESSURE, O2, O2_PROBES, LUMINOSITY
+#define MEASURE_SNAPSHOT_CHANNEL_COUNT 7
+#define MEASURE_SNAPSHOT_O2_PROBES_CHANNEL 5
+#define MEASURE_SNAPSHOT_MAX_PROBES 8
+#define MEASURE_SNAPSHOT_SERIAL_SIZE 16
+
+/**
+ * @brief The value of a Fibox probe.
+ */
+struct MeasureSnapshotProbe
+{
+    char serial[MEASURE_SNAPSHOT_SERIAL_SIZE]; // Serial number of the Fibox (null-terminated)
+    float value;                               // O2 (NaN if not available)
+    uint32_t reserved;
+};
+
+/**
+ * @brief The data of a snapshot (copied by the reader).
+ * A channel whose valid bit is not set keeps the last available value and its timestamp (NaN and 0 if never available).
+ */
+struct MeasureSnapshotData
+{
+    uint64_t sequence;                                   // Number of snapshots written since the start of the daemon
+    int64_t timestamp;                                   // Time of the snapshot (milliseconds since epoch)
+    uint32_t validMask;                                  // Bit set if the value of the channel is from this snapshot (bit index: channel)
+    uint32_t probeCount;                                 // Number of probes in the probes array
+    float values[MEASURE_SNAPSHOT_CHANNEL_COUNT];        // Value of each channel (the O2_PROBES one is unused)
+    uint32_t reserved;
+    int64_t timestamps[MEASURE_SNAPSHOT_CHANNEL_COUNT];  // Time of the value of each channel (milliseconds since epoch)
+    MeasureSnapshotProbe probes[MEASURE_SNAPSHOT_MAX_PROBES];
+};
+
+/**
+ * @brief The shared memory segment.
+ */
+struct MeasureSnapshotSegment
+{
+    std::atomic<uint32_t> magic;
+    uint16_t version;
+    uint16_t channelCount;
+    uint32_t size;                  // Size of the segment in bytes
+    std::atomic<uint32_t> seqlock;  // Odd while the daemon writes the data
+    MeasureSnapshotData data;
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "The seqlock must be lock-free to be shared between processes.");
+
+/**
+ * @brief Reader of the shared memory segment (header-only, for the local clients).
+ *
+ * Usage:
+ *   MeasureSnapshotReader reader;
+ *   MeasureSnapshotData data;
+ *   if (reader.open() && reader.read(data)) { ... data.values[1] ... }
+ */
+class MeasureSnapshotReader
+{
+public:
+    MeasureSnapshotReader() : segment(nullptr) {}
+    ~MeasureSnapshotReader() { close(); }
+
+    MeasureSnapshotReader(const MeasureSnapshotReader&) = delete;
+    MeasureSnapshotReader& operator=(const MeasureSnapshotReader&) = delete;
+
+    /**
+     * @brief Maps the segment (read only).
+     *
+     * @param name The name of the segment.
+     * @return False if the segment does not exist, is not readable or has an unknown layout.
+     */
+    bool open(const char* name = MEASURE_SNAPSHOT_SEGMENT_NAME)
+    {
+        close();
+
+        int fd = shm_open(name, O_RDONLY, 0);
+        if (fd < 0) {
+            return false;
+        }
+
+        struct stat info;
+        if (fstat(fd, &info) < 0 || (size_t)info.st_size < sizeof(MeasureSnapshotSegment)) {
+            ::close(fd);
+            return false;
+        }
+
+        void* address = mmap(nullptr, sizeof(MeasureSnapshotSegment), PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (address == MAP_FAILED) {
+            return false;
+        }
+
+        segment = (const MeasureSnapshotSegment*)address;
+        if (segment->magic.load(std::memory_order_acquire) != MEASURE_SNAPSHOT_MAGIC
+            || segment->version != MEASURE_SNAPSHOT_VERSION
+            || segment->channelCount != MEASURE_SNAPSHOT_CHANNEL_COUNT
+            || segment->size != sizeof(MeasureSnapshotSegment)) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Unmaps the segment.
+     */
+    void close()
+    {
+        if (segment != nullptr) {
+            munmap((void*)segment, sizeof(MeasureSnapshotSegment));
+            segment = nullptr;
+        }
+    }
+
+    /**
+     * @brief Gets if the segment is mapped.
+     */
+    bool isOpen() const
+    {
+        return segment != nullptr;
+    }
+
+    /**
+     * @brief Copies the latest snapshot (no system call).
+     *
+     * @param data The copy of the snapshot.
+     * @param maxRetries The number of copies to try while the daemon writes the segment.
+     * @return False if the segment is not mapped, if no snapshot was written yet or if every copy was torn.
+     */
+    bool read(MeasureSnapshotData& data, int maxRetries = 1000) const
+    {
+        if (segment == nullptr) {
+            return false;
+        }
+
+        for (int i = 0; i < maxRetries; i++) {
+            uint32_t begin = segment->seqlock.load(std::memory_order_acquire);
+            if (begin & 1) {
+                continue;
+            }
+
+            memcpy(&data, (const void*)&segment->data, sizeof(MeasureSnapshotData));
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (segment->seqlock.load(std::memory_order_relaxed) == begin) {
+                return data.sequence != 0;
+            }
+        }
+        return false;
+    }
+
+private:
+    const MeasureSnapshotSegment* segment;
+};
+
+#endif // MEASURESNAPSHOT_H
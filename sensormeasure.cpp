@@ -56,6 +56,23 @@ String SensorMeasure::getO2()
     }
 }
 
+void SensorMeasure::setO2Probes(map<String, float> o2Probes)
+{
+    this->o2Probes = o2Probes;
+}
+
+String SensorMeasure::getO2Probes()
+{
+    String res = "{";
+    for (const auto& pair : o2Probes) {
+        if (res.length() > 1) {
+            res += ", ";
+        }
+        res += "\"" + pair.first + "\": " + (pair.second == __FLT_MIN__ ? "null" : to_string(pair.second));
+    }
+    return res + "}";
+}
+
 String SensorMeasure::getLuminosity()
 {
     if (luminosity == __FLT_MIN__) {
@@ -65,6 +82,31 @@ String SensorMeasure::getLuminosity()
     }
 }
 
+float SensorMeasure::getValue(Channel channel)
+{
+    switch (channel) {
+    case CO2:
+        return co2;
+    case TEMPERATURE:
+        return temperature;
+    case HUMIDITY:
+        return humidity;
+    case PRESSURE:
+        return pressure;
+    case O2:
+        return o2;
+    case LUMINOSITY:
+        return luminosity;
+    default:
+        return __FLT_MIN__;
+    }
+}
+
+const map<String, float>& SensorMeasure::getO2ProbesValues()
+{
+    return o2Probes;
+}
+
 bool SensorMeasure::isComplete()
 {
     return this->complete;
@@ -2,6 +2,7 @@
 #define SENSORMEASURE_H
 
 #include "types.h"
+#include <map>
 using namespace std;
 
 /**
@@ -9,6 +10,21 @@ using namespace std;
  */
 class SensorMeasure
 {
+public:
+    /**
+     * @brief The measures, in the order of the measurements data (GET_MEASURE).
+     */
+    enum Channel {
+        CO2,
+        TEMPERATURE,
+        HUMIDITY,
+        PRESSURE,
+        O2,
+        O2_PROBES,
+        LUMINOSITY,
+        CHANNEL_COUNT
+    };
+
 private:
     float temperature;
     float humidity;
@@ -16,6 +32,7 @@ private:
     float co2;
     float o2;
     float luminosity;
+    map<String, float> o2Probes;
     bool complete;
 
 public:
@@ -56,6 +73,20 @@ public:
      */
     String getO2();
 
+    /**
+     * @brief Sets the o2 of each Fibox probe.
+     * 
+     * @param o2Probes The o2 values (key: serial number of the Fibox, __FLT_MIN__ if not available).
+     */
+    void setO2Probes(map<String, float> o2Probes);
+
+    /**
+     * @brief Gets the o2 of each Fibox probe.
+     * 
+     * @return The o2 of each probe as a JSON object string (key: serial number).
+     */
+    String getO2Probes();
+
     /**
      * @brief Gets the luminosity of the measure.
      * 
@@ -63,6 +94,21 @@ public:
      */
     String getLuminosity();
 
+    /**
+     * @brief Gets the value of a measure.
+     *
+     * @param channel The measure (O2_PROBES is not a single value, see getO2ProbesValues).
+     * @return The value, __FLT_MIN__ if not available.
+     */
+    float getValue(Channel channel);
+
+    /**
+     * @brief Gets the o2 of each Fibox probe.
+     *
+     * @return The o2 values (key: serial number of the Fibox, __FLT_MIN__ if not available).
+     */
+    const map<String, float>& getO2ProbesValues();
+
     /**
 	 * @brief Gets if the measure is complete (no null values).
 	 * 
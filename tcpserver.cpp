@@ -0,0 +1,424 @@
+#include "tcpserver.h"
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/epoll.h>
+#include <netinet/in.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#define CLIENT_EVENTS (EPOLLIN | EPOLLRDHUP | EPOLLET)
+
+TcpServer::TcpServer(EventLoop* loop, RequestHandler handler)
+{
+    this->loop = loop;
+    this->handler = handler;
+}
+
+bool TcpServer::listen(int port)
+{
+    // Create a socket
+    int serverSocket = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (serverSocket < 0) {
+        perror("Error creating socket");
+        return false;
+    }
+
+    int reuse = 1;
+    setsockopt(serverSocket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    // Set up the server address structure
+    struct sockaddr_in serverAddress {};
+    serverAddress.sin_family = AF_INET;
+    serverAddress.sin_addr.s_addr = INADDR_ANY;
+    serverAddress.sin_port = htons(port);
+
+    // Bind the socket to the specified address and port
+    if (bind(serverSocket, (struct sockaddr*)&serverAddress, sizeof(serverAddress)) < 0) {
+        perror("Error binding socket");
+        close(serverSocket);
+        return false;
+    }
+
+    return startListening(serverSocket, nullptr);
+}
+
+bool TcpServer::listenUnix(String path, PeerFilter filter)
+{
+    struct sockaddr_un serverAddress {};
+    if (path.size() >= sizeof(serverAddress.sun_path)) {
+        fprintf(stderr, "Error creating Unix socket: path too long\n");
+        return false;
+    }
+    serverAddress.sun_family = AF_UNIX;
+    strcpy(serverAddress.sun_path, path.c_str());
+
+    int serverSocket = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (serverSocket < 0) {
+        perror("Error creating Unix socket");
+        return false;
+    }
+
+    // A socket file left by a previous run would make bind fail
+    unlink(path.c_str());
+    if (bind(serverSocket, (struct sockaddr*)&serverAddress, sizeof(serverAddress)) < 0) {
+        perror("Error binding Unix socket");
+        close(serverSocket);
+        return false;
+    }
+    chmod(path.c_str(), 0660);
+
+    return startListening(serverSocket, filter);
+}
+
+bool TcpServer::startListening(int serverSocket, PeerFilter filter)
+{
+    // Listen for incoming connections
+    if (::listen(serverSocket, SOMAXCONN) < 0) {
+        perror("Error listening for connections");
+        close(serverSocket);
+        return false;
+    }
+
+    return loop->addFd(serverSocket, EPOLLIN, [this, serverSocket, filter](uint32_t) { acceptClients(serverSocket, filter); });
+}
+
+void TcpServer::acceptClients(int serverSocket, PeerFilter filter)
+{
+    while (true) {
+        int clientSocket = accept4(serverSocket, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (clientSocket < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                perror("Error accepting connection");
+            }
+            if (errno != EINTR) {
+                return;
+            }
+            continue;
+        }
+
+        if (filter) {
+            struct ucred peer {};
+            socklen_t length = sizeof(peer);
+            if (getsockopt(clientSocket, SOL_SOCKET, SO_PEERCRED, &peer, &length) < 0 || !filter(peer)) {
+                fprintf(stderr, "Unix socket client refused (uid %d, pid %d)\n", (int)peer.uid, (int)peer.pid);
+                close(clientSocket);
+                continue;
+            }
+        }
+
+        TcpConnection* connection = new TcpConnection();
+        connection->fd = clientSocket;
+        connection->writeOffset = 0;
+        connection->answersOffset = 0;
+        connection->pendingPushes = 0;
+        connection->protocol = TCP_PROTOCOL_TEXT;
+        connection->writeWatched = false;
+        connection->closing = false;
+        connections[clientSocket] = unique_ptr<TcpConnection>(connection);
+
+        if (!loop->addFd(clientSocket, CLIENT_EVENTS, [this, connection](uint32_t events) { handleEvents(connection, events); })) {
+            connections.erase(clientSocket);
+            close(clientSocket);
+        }
+    }
+}
+
+void TcpServer::handleEvents(TcpConnection* connection, uint32_t events)
+{
+    if (events & (EPOLLERR | EPOLLHUP)) {
+        closeConnection(connection);
+        return;
+    }
+
+    if ((events & EPOLLOUT) && !flush(connection)) {
+        return;
+    }
+
+    // EPOLLRDHUP: the pending messages are read before the end of the stream
+    if ((events & (EPOLLIN | EPOLLRDHUP)) && !connection->closing) {
+        readMessages(connection);
+    }
+}
+
+bool TcpServer::readMessages(TcpConnection* connection)
+{
+    // Edge-triggered: the socket must be drained
+    while (true) {
+        ssize_t bytesRead = read(connection->fd, readBuffer, sizeof(readBuffer));
+        if (bytesRead < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                // Socket drained: the answers of all the messages read are sent at once
+                return flush(connection);
+            }
+            perror("Error reading from socket");
+            closeConnection(connection);
+            return false;
+        } else if (bytesRead == 0) {
+            // End of the client stream: the pending answers are still sent (the client may only have shut down its writes)
+            closeWhenSent(connection);
+            return false;
+        }
+
+        connection->readBuffer.append(readBuffer, bytesRead);
+        if (!handleMessages(connection)) {
+            return false;
+        }
+    }
+}
+
+bool TcpServer::handleMessages(TcpConnection* connection)
+{
+    size_t start = 0;
+    size_t end;
+    while ((end = connection->readBuffer.find(TCP_MESSAGE_DELIMITER, start)) != String::npos) {
+        // The message is null-terminated in place (no copy)
+        char* message = &connection->readBuffer[start];
+        connection->readBuffer[end] = '\0';
+        if (end > start && connection->readBuffer[end - 1] == '\r') {
+            connection->readBuffer[end - 1] = '\0'; // CRLF delimiter
+        }
+        start = end + 1;
+        if (message[strspn(message, " \r\t")] == '\0') {
+            continue; // empty line
+        }
+
+        // a protocol change applies after the answer of the request changing it
+        bool delimited = connection->protocol == TCP_PROTOCOL_TEXT;
+
+        response.data.clear();
+        response.tail.reset();
+        bool keepOpen = handler(connection->fd, message, response);
+        if (response.tail != nullptr) {
+            // The shared tail is queued as is (no copy), the delimiter starts the next answers
+            queueAnswers(connection);
+            TcpFrame& frame = queueFrame(connection, false);
+            frame.data = response.data;
+            frame.tail = move(response.tail);
+            if (delimited) {
+                connection->answers += TCP_MESSAGE_DELIMITER;
+            }
+        }
+        else if (!response.data.empty()) {
+            connection->answers += response.data;
+            if (delimited) {
+                connection->answers += TCP_MESSAGE_DELIMITER;
+            }
+        }
+        if (!keepOpen) {
+            // The answers of the previous messages are still sent, the next messages are ignored
+            closeWhenSent(connection);
+            return false;
+        }
+    }
+    connection->readBuffer.erase(0, start);
+
+    // The rest is the start of the next message
+    if (connection->readBuffer.size() > TCP_MAX_MESSAGE_SIZE) {
+        fprintf(stderr, "Closing a TCP connection: message longer than %d bytes\n", TCP_MAX_MESSAGE_SIZE);
+        closeConnection(connection);
+        return false;
+    }
+
+    return true;
+}
+
+bool TcpServer::flush(TcpConnection* connection)
+{
+    // Gather the pending messages in one system call
+    while (!connection->writeQueue.empty() || connection->answersOffset < connection->answers.size()) {
+        struct iovec iov[TCP_MAX_IOV];
+        int count = 0;
+        size_t offset = connection->writeOffset;
+        for (auto it = connection->writeQueue.begin(); it != connection->writeQueue.end() && count < TCP_MAX_IOV; it++) {
+            if (offset < it->data.size()) {
+                iov[count].iov_base = (void*)(it->data.data() + offset);
+                iov[count].iov_len = it->data.size() - offset;
+                count++;
+                offset = 0;
+            }
+            else {
+                offset -= it->data.size();
+            }
+            if (it->tail != nullptr && count < TCP_MAX_IOV) {
+                iov[count].iov_base = (void*)(it->tail->data() + offset);
+                iov[count].iov_len = it->tail->size() - offset;
+                count++;
+            }
+            offset = 0;
+        }
+        if (count < TCP_MAX_IOV && connection->answersOffset < connection->answers.size()) {
+            iov[count].iov_base = (void*)(connection->answers.data() + connection->answersOffset);
+            iov[count].iov_len = connection->answers.size() - connection->answersOffset;
+            count++;
+        }
+
+        struct msghdr msg {};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = count;
+        ssize_t written = sendmsg(connection->fd, &msg, MSG_NOSIGNAL);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            perror("Error writing to socket");
+            closeConnection(connection);
+            return false;
+        }
+
+        // Remove the messages fully sent
+        size_t remaining = written;
+        while (remaining > 0 && !connection->writeQueue.empty()) {
+            const TcpFrame& frame = connection->writeQueue.front();
+            size_t left = frame.data.size() + (frame.tail != nullptr ? frame.tail->size() : 0) - connection->writeOffset;
+            if (remaining < left) {
+                connection->writeOffset += remaining;
+                remaining = 0;
+                break;
+            }
+            remaining -= left;
+            if (frame.pushed) {
+                connection->pendingPushes--;
+            }
+            releaseFrame(connection, connection->writeQueue.begin());
+            connection->writeOffset = 0;
+        }
+        connection->answersOffset += remaining;
+        if (connection->answersOffset == connection->answers.size()) {
+            connection->answers.clear();
+            connection->answersOffset = 0;
+        }
+    }
+
+    // Watch EPOLLOUT only while data is pending
+    bool pending = !connection->writeQueue.empty() || !connection->answers.empty();
+    if (!pending && connection->closing) {
+        closeConnection(connection);
+        return false;
+    }
+    if (pending != connection->writeWatched) {
+        loop->modifyFd(connection->fd, pending ? CLIENT_EVENTS | EPOLLOUT : CLIENT_EVENTS);
+        connection->writeWatched = pending;
+    }
+
+    return true;
+}
+
+void TcpServer::closeWhenSent(TcpConnection* connection)
+{
+    connection->closing = true;
+    connection->readBuffer.clear();
+    flush(connection);
+}
+
+void TcpServer::addCloseHandler(CloseHandler handler)
+{
+    this->closeHandlers.push_back(handler);
+}
+
+bool TcpServer::push(int connectionId, const String& data, bool droppable)
+{
+    auto it = connections.find(connectionId);
+    if (it == connections.end()) {
+        return false;
+    }
+    TcpConnection* connection = it->second.get();
+    if (droppable && connection->closing) {
+        return true;
+    }
+
+    // Slow client: drop its oldest pushed message (unless it is being sent)
+    if (droppable && connection->pendingPushes >= TCP_MAX_PENDING_PUSHES) {
+        auto frame = connection->writeQueue.begin();
+        if (connection->writeOffset > 0) {
+            frame++;
+        }
+        while (frame != connection->writeQueue.end() && !frame->pushed) {
+            frame++;
+        }
+        if (frame != connection->writeQueue.end()) {
+            releaseFrame(connection, frame);
+            connection->pendingPushes--;
+        }
+    }
+
+    // The answers not sent yet stay before the pushed message
+    queueAnswers(connection);
+
+    TcpFrame& frame = queueFrame(connection, droppable);
+    frame.data = data;
+    if (connection->protocol == TCP_PROTOCOL_TEXT) {
+        frame.data += TCP_MESSAGE_DELIMITER;
+    }
+    if (droppable) {
+        connection->pendingPushes++;
+    }
+    return flush(connection);
+}
+
+TcpFrame& TcpServer::queueFrame(TcpConnection* connection, bool pushed)
+{
+    if (connection->spareFrames.empty()) {
+        connection->writeQueue.emplace_back();
+    }
+    else {
+        connection->writeQueue.splice(connection->writeQueue.end(), connection->spareFrames, connection->spareFrames.begin());
+    }
+
+    TcpFrame& frame = connection->writeQueue.back();
+    frame.data.clear();
+    frame.tail.reset();
+    frame.pushed = pushed;
+    return frame;
+}
+
+void TcpServer::releaseFrame(TcpConnection* connection, list<TcpFrame>::iterator frame)
+{
+    // The shared tail (cached measure) is released at once, the buffer is kept
+    frame->tail.reset();
+    connection->spareFrames.splice(connection->spareFrames.begin(), connection->writeQueue, frame);
+}
+
+void TcpServer::queueAnswers(TcpConnection* connection)
+{
+    if (connection->answersOffset < connection->answers.size()) {
+        queueFrame(connection, false).data.assign(connection->answers, connection->answersOffset, String::npos);
+    }
+    connection->answers.clear();
+    connection->answersOffset = 0;
+}
+
+void TcpServer::setProtocol(int connection, TcpProtocol protocol)
+{
+    auto it = connections.find(connection);
+    if (it != connections.end()) {
+        it->second->protocol = protocol;
+    }
+}
+
+TcpProtocol TcpServer::getProtocol(int connection)
+{
+    auto it = connections.find(connection);
+    return it != connections.end() ? it->second->protocol : TCP_PROTOCOL_TEXT;
+}
+
+void TcpServer::closeConnection(TcpConnection* connection)
+{
+    int fd = connection->fd;
+    loop->removeFd(fd);
+    close(fd);
+    connections.erase(fd);
+
+    for (CloseHandler& closeHandler : closeHandlers) {
+        closeHandler(fd);
+    }
+}
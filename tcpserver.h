@@ -0,0 +1,344 @@
+#ifndef TCPSERVER_H
+#define TCPSERVER_H
+
+#include <functional>
+#include <map>
+#include <list>
+#include <vector>
+#include <memory>
+#include <sys/socket.h>
+#include "types.h"
+#include "eventloop.h"
+using namespace std;
+
+// Size of the buffer used to read the client messages
+#define TCP_READ_BUFFER_SIZE 1024
+
+// Maximum size of a message (the connection is closed if a message is longer)
+#define TCP_MAX_MESSAGE_SIZE 4096
+
+// Delimiter of the messages (requests and answers)
+#define TCP_MESSAGE_DELIMITER '\n'
+
+// Maximum number of answers gathered in one send
+#define TCP_MAX_IOV 64
+
+// Maximum number of pushed messages waiting for a slow client (the oldest are dropped)
+#define TCP_MAX_PENDING_PUSHES 8
+
+/**
+ * @brief The protocol of the answers sent to a client (selected by the client with SET_PROTOCOL).
+ * The requests are always newline-delimited text.
+ */
+enum TcpProtocol
+{
+    TCP_PROTOCOL_TEXT,           // newline-delimited JSON answers
+    TCP_PROTOCOL_BINARY_FLOAT32, // length-prefixed binary frames (see BinaryFrame), float32 values
+    TCP_PROTOCOL_BINARY_FLOAT64  // length-prefixed binary frames (see BinaryFrame), float64 values
+};
+
+/**
+ * @brief The TcpResponse struct is the answer of a request: its data followed by an optional tail shared between
+ * several answers (e.g. a serialized measure), which is sent without being copied.
+ */
+struct TcpResponse
+{
+    String data;
+    shared_ptr<const String> tail;
+};
+
+/**
+ * @brief The TcpFrame struct is a message waiting to be sent to a client.
+ */
+struct TcpFrame
+{
+    String data;
+
+    /**
+     * @brief The shared end of the message, sent after data (nullptr if none).
+     */
+    shared_ptr<const String> tail;
+
+    /**
+     * @brief True if the message has been pushed by the server (it can be dropped for a slow client),
+     * false if it is the answer of a request.
+     */
+    bool pushed;
+};
+
+/**
+ * @brief The TcpConnection struct is the state of a client connection of the TCP server.
+ */
+struct TcpConnection
+{
+    int fd;
+
+    /**
+     * @brief The received data not handled yet (start of an incomplete message).
+     */
+    String readBuffer;
+
+    /**
+     * @brief The messages waiting to be sent to the client, in the order of the requests.
+     */
+    list<TcpFrame> writeQueue;
+
+    /**
+     * @brief The frames already sent, reused for the next messages: their nodes and buffers keep their memory,
+     * so queuing a message does not allocate once the connection reached its usual queue length.
+     */
+    list<TcpFrame> spareFrames;
+
+    /**
+     * @brief The answers waiting to be sent after writeQueue, concatenated (the buffer keeps its capacity
+     * from one request to the next). They are moved to writeQueue when a message is pushed after them.
+     */
+    String answers;
+
+    /**
+     * @brief The number of bytes of answers already sent.
+     */
+    size_t answersOffset;
+
+    /**
+     * @brief The number of pushed messages in writeQueue.
+     */
+    size_t pendingPushes;
+
+    /**
+     * @brief The number of bytes of the first answer of writeQueue already sent.
+     */
+    size_t writeOffset;
+
+    /**
+     * @brief The protocol of the answers (no delimiter is added to the binary frames).
+     */
+    TcpProtocol protocol;
+
+    /**
+     * @brief True if EPOLLOUT is watched (pending answers in writeQueue).
+     */
+    bool writeWatched;
+
+    /**
+     * @brief True once the connection must be closed (request asking for it, end of the client stream):
+     * nothing is read anymore and the connection is closed as soon as its pending messages are sent.
+     */
+    bool closing;
+};
+
+/**
+ * @brief The TcpServer class is the daemon's TCP server.
+ * It runs on the event loop: the sockets are non-blocking, the reads are edge-triggered and
+ * the answers are buffered when the client does not read them fast enough, so no thread is created per client.
+ * The messages are newline-delimited: a message split across several reads is reassembled and
+ * several messages received in one read are handled one by one. Each answer also ends with a newline.
+ * A client can pipeline its requests: they are handled in arrival order and the answers of all the
+ * requests read at once are sent together (in the same order) with a single gathered write.
+ * Messages can also be pushed to a client at any time (subscriptions): for a slow client, the oldest
+ * pushed messages are dropped so its memory stays bounded.
+ * The same command set is served on a TCP port and on an optional Unix domain socket (local clients).
+ */
+class TcpServer
+{
+public:
+    /**
+     * @brief Handler called with each message received from a client.
+     *
+     * @param connection The id of the client connection.
+     * @param message The received message (null-terminated, without the delimiter, valid during the call only).
+     * @param response The response to send to the client (nothing is sent if empty). Its data buffer is empty and
+     * reused from one request to the next, so assigning it does not allocate once it is large enough.
+     * @return False to close the connection.
+     */
+    typedef function<bool(int connection, char* message, TcpResponse& response)> RequestHandler;
+
+    /**
+     * @brief Handler called when a client connection is closed.
+     *
+     * @param connection The id of the client connection.
+     */
+    typedef function<void(int connection)> CloseHandler;
+
+    /**
+     * @brief Access control of the Unix domain socket clients.
+     *
+     * @param peer The credentials of the client process (SO_PEERCRED).
+     * @return True to accept the client.
+     */
+    typedef function<bool(const struct ucred& peer)> PeerFilter;
+
+    /**
+     * @brief Constructs a new TcpServer object.
+     *
+     * @param loop The event loop running the server.
+     * @param handler The handler of the client messages.
+     */
+    TcpServer(EventLoop* loop, RequestHandler handler);
+
+    /**
+     * @brief Creates the server socket and starts accepting the clients.
+     *
+     * @param port The TCP port.
+     * @return False if the server socket could not be created.
+     */
+    bool listen(int port);
+
+    /**
+     * @brief Creates a Unix domain stream socket and starts accepting the local clients.
+     * An existing file at this path is replaced. The socket is readable and writable by its owner and group.
+     *
+     * @param path The path of the socket.
+     * @param filter The access control of the clients.
+     * @return False if the socket could not be created.
+     */
+    bool listenUnix(String path, PeerFilter filter);
+
+    /**
+     * @brief Adds a handler called when a client connection is closed.
+     *
+     * @param handler The handler.
+     */
+    void addCloseHandler(CloseHandler handler);
+
+    /**
+     * @brief Pushes a message to a client (without request).
+     * Must be called from the event loop thread.
+     *
+     * @param connection The id of the client connection.
+     * @param data The message (without delimiter, already encoded with the protocol of the client).
+     * @param droppable False for the deferred answer of a request, which is never dropped for a slow client
+     * (the droppable messages are not sent anymore to a closing connection, so that it can be closed).
+     * @return False if the connection does not exist anymore.
+     */
+    bool push(int connection, const String& data, bool droppable = true);
+
+    /**
+     * @brief Sets the protocol of the answers of a client.
+     * The answer of the current request is still sent with the previous protocol.
+     *
+     * @param connection The id of the client connection.
+     * @param protocol The protocol.
+     */
+    void setProtocol(int connection, TcpProtocol protocol);
+
+    /**
+     * @brief Gets the protocol of the answers of a client.
+     *
+     * @param connection The id of the client connection.
+     * @return The protocol (text if the connection does not exist).
+     */
+    TcpProtocol getProtocol(int connection);
+
+private:
+    /**
+     * @brief Accepts all the pending connections of a server socket.
+     *
+     * @param serverSocket The server socket.
+     * @param filter The access control of the clients (nullptr to accept all of them).
+     */
+    void acceptClients(int serverSocket, PeerFilter filter);
+
+    /**
+     * @brief Starts listening on a bound server socket and registers it in the event loop.
+     *
+     * @param serverSocket The bound server socket (closed on error).
+     * @param filter The access control of the clients (nullptr to accept all of them).
+     * @return False on error.
+     */
+    bool startListening(int serverSocket, PeerFilter filter);
+
+    /**
+     * @brief Handles the epoll events of a client connection.
+     *
+     * @param connection The client connection.
+     * @param events The ready epoll events.
+     */
+    void handleEvents(TcpConnection* connection, uint32_t events);
+
+    /**
+     * @brief Handles the complete messages of the read buffer of a client.
+     *
+     * @param connection The client connection.
+     * @return False if the connection has been closed or is closing (see closeWhenSent).
+     */
+    bool handleMessages(TcpConnection* connection);
+
+    /**
+     * @brief Reads and handles the messages of a client until its socket is drained.
+     *
+     * @param connection The client connection.
+     * @return False if the connection has been closed or is closing (see closeWhenSent).
+     */
+    bool readMessages(TcpConnection* connection);
+
+    /**
+     * @brief Sends the pending answers of a client without blocking (gathered in one sendmsg when possible).
+     * EPOLLOUT is watched as long as answers remain. A closing connection is closed once everything is sent.
+     *
+     * @param connection The client connection.
+     * @return False if the connection has been closed.
+     */
+    bool flush(TcpConnection* connection);
+
+    /**
+     * @brief Stops reading a client and closes its connection once its pending messages are sent
+     * (right now if they can all be sent, from the EPOLLOUT handling otherwise).
+     *
+     * @param connection The client connection.
+     */
+    void closeWhenSent(TcpConnection* connection);
+
+    /**
+     * @brief Adds a frame at the end of the write queue, reusing a spare frame if there is one.
+     *
+     * @param connection The client connection.
+     * @param pushed True if the message is pushed by the server, false if it is the answer of a request.
+     * @return The frame, to fill (its data is empty and it has no tail).
+     */
+    TcpFrame& queueFrame(TcpConnection* connection, bool pushed);
+
+    /**
+     * @brief Removes a frame from the write queue and keeps it for the next messages.
+     *
+     * @param connection The client connection.
+     * @param frame The frame.
+     */
+    void releaseFrame(TcpConnection* connection, list<TcpFrame>::iterator frame);
+
+    /**
+     * @brief Moves the answers not sent yet to the end of the write queue (before queuing another message).
+     *
+     * @param connection The client connection.
+     */
+    void queueAnswers(TcpConnection* connection);
+
+    /**
+     * @brief Closes a client connection and releases its state.
+     *
+     * @param connection The client connection.
+     */
+    void closeConnection(TcpConnection* connection);
+
+    EventLoop* loop;
+    RequestHandler handler;
+    vector<CloseHandler> closeHandlers;
+
+    /**
+     * @brief The client connections (key: socket).
+     * Only used from the event loop thread.
+     */
+    map<int, unique_ptr<TcpConnection>> connections;
+
+    /**
+     * @brief The buffer receiving the client messages (shared by all the connections).
+     */
+    char readBuffer[TCP_READ_BUFFER_SIZE];
+
+    /**
+     * @brief The response given to the handler (shared by all the connections).
+     */
+    TcpResponse response;
+};
+
+#endif // TCPSERVER_H
@@ -0,0 +1,56 @@
+#include "allocations.h"
+#include <atomic>
+#include <new>
+#include <cstdlib>
+
+static std::atomic<bool> counting(false);
+static std::atomic<size_t> allocations(0);
+
+void* operator new(size_t size)
+{
+    if (counting) {
+        allocations++;
+    }
+    void* pointer = malloc(size ? size : 1);
+    if (pointer == nullptr) {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* pointer) noexcept
+{
+    free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+    free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept
+{
+    free(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept
+{
+    free(pointer);
+}
+
+void startCountingAllocations()
+{
+    allocations = 0;
+    counting = true;
+}
+
+size_t stopCountingAllocations()
+{
+    counting = false;
+    return allocations;
+}
@@ -0,0 +1,13 @@
+#ifndef ALLOCATIONS_H
+#define ALLOCATIONS_H
+
+#include <cstddef>
+
+/**
+ * The global operator new is replaced to count the heap allocations of all the threads while counting is started.
+ * The replacement lives in its own translation unit so the compiler does not pair the inlined new and delete of the tests.
+ */
+void startCountingAllocations();
+size_t stopCountingAllocations();
+
+#endif // ALLOCATIONS_H
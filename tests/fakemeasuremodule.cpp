@@ -0,0 +1,128 @@
+#include "../measuremodule.h"
+#include "../measurepublisher.h"
+
+/*
+ * Fake of the measure module and of the measure publisher for the tests of the request path:
+ * no sensor, no USB device and no thread. The module gives a complete measure, which only changes with the generation.
+ * The members of the real module are used, so the fake answers have the layout of the real ones.
+ */
+
+FiboxBus::FiboxBus(EventLoop* loop)
+{
+    this->context = nullptr;
+    this->loop = loop;
+    this->usbTimer = -1;
+    this->hotplugRegistered = false;
+}
+
+MeasureModule::MeasureModule(EventLoop* loop) : fiboxBus(loop)
+{
+    this->stopped = false;
+    this->initialising = false;
+    this->generation = 1;
+    this->resetRunning = false;
+    this->config = make_shared<const MeasureConfig>();
+
+    // GET_STATS answers with values
+    this->temperatureStats.add(21.4);
+    this->temperatureStats.add(21.6);
+}
+
+SensorMeasure* MeasureModule::get(bool /*reportErrors*/)
+{
+    SensorMeasure* measure = new SensorMeasure(21.5f, 45.2f, 1013.25f, 0.04f, 20.9f, 350.0f);
+    measure->setO2Probes({ { "FIBOX-0001", 20.9f } });
+    return measure;
+}
+
+bool MeasureModule::setConfig(int, double, double, double, double, double, double, double, double, double, double, double, double, bool, bool, bool, String)
+{
+    return true;
+}
+
+bool MeasureModule::getStats(SensorMeasure::Channel channel, String /*serial*/, int window, WindowStats::Result& result)
+{
+    switch (channel) {
+    case SensorMeasure::CO2:
+        result = co2Stats.get(window);
+        return true;
+    case SensorMeasure::TEMPERATURE:
+        result = temperatureStats.get(window);
+        return true;
+    case SensorMeasure::HUMIDITY:
+        result = humidityStats.get(window);
+        return true;
+    case SensorMeasure::PRESSURE:
+        result = pressureStats.get(window);
+        return true;
+    case SensorMeasure::LUMINOSITY:
+        result = luminosityStats.get(window);
+        return true;
+    default:
+        return false;
+    }
+}
+
+shared_ptr<const MeasureConfig> MeasureModule::getConfig(String /*serial*/)
+{
+    return config;
+}
+
+bool MeasureModule::saveProfile(String, String)
+{
+    return true;
+}
+
+void MeasureModule::loadProfile(String, String)
+{
+}
+
+void MeasureModule::setFastMath(bool)
+{
+}
+
+list<DriverError> MeasureModule::getErrors()
+{
+    return errorArray;
+}
+
+bool MeasureModule::isInitialising() const
+{
+    return initialising;
+}
+
+bool MeasureModule::isStopped() const
+{
+    return stopped;
+}
+
+UInt MeasureModule::getGeneration() const
+{
+    return generation;
+}
+
+vector<FiboxLinkStats> MeasureModule::getFiboxLinkStats()
+{
+    return vector<FiboxLinkStats>();
+}
+
+void MeasureModule::reset(ResetHandler /*handler*/)
+{
+}
+
+void MeasurePublisher::subscribe(int, String, vector<String>, int)
+{
+}
+
+bool MeasurePublisher::unsubscribe(int)
+{
+    return false;
+}
+
+void MeasurePublisher::startMulticast(String, int)
+{
+}
+
+void MeasurePublisher::stopMulticast()
+{
+}
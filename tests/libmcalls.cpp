@@ -0,0 +1,25 @@
+#include "libmcalls.h"
+
+static size_t libmCalls = 0;
+
+extern "C" {
+    double __real_tan(double x);
+    double __real_exp(double x);
+    double __real_log(double x);
+    double __real_pow(double x, double y);
+
+    double __wrap_tan(double x) { libmCalls++; return __real_tan(x); }
+    double __wrap_exp(double x) { libmCalls++; return __real_exp(x); }
+    double __wrap_log(double x) { libmCalls++; return __real_log(x); }
+    double __wrap_pow(double x, double y) { libmCalls++; return __real_pow(x, y); }
+}
+
+void resetLibmCalls()
+{
+    libmCalls = 0;
+}
+
+size_t getLibmCalls()
+{
+    return libmCalls;
+}
@@ -0,0 +1,13 @@
+#ifndef LIBMCALLS_H
+#define LIBMCALLS_H
+
+#include <cstddef>
+
+/**
+ * The libm transcendental functions (tan, exp, log, pow) are wrapped at link time (-Wl,--wrap) to count their calls.
+ * The counter lives in its own translation unit so the compiler cannot move it across the (pure) libm calls.
+ */
+void resetLibmCalls();
+size_t getLibmCalls();
+
+#endif // LIBMCALLS_H
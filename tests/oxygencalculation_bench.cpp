@@ -0,0 +1,327 @@
+#define _USE_MATH_DEFINES
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include "../MeasureConfig.h"
+#include "../Fibox-driver/oxygencalculation.h"
+#include "../Fibox-driver/fastmath.h"
+#include "referenceoxygencalculation.h"
+#ifdef COUNT_LIBM_CALLS
+#include "libmcalls.h"
+#endif
+
+using namespace std;
+
+// Maximum relative difference accepted between the computed and the golden oxygen values
+#define GOLDEN_TOLERANCE 1e-9
+
+// Maximum relative difference accepted in fast-math mode (the approximation errors of FastMath, amplified by the calculation)
+#define FAST_MATH_TOLERANCE 1e-7
+
+// Number of passes over the dataset of each configuration when measuring the calculation time
+#define BENCH_PASSES 2500
+
+/**
+ * @brief The samples of the golden dataset sharing one configuration (structure of arrays, as computeBatch expects them)
+ */
+struct GoldenSet {
+    bool calibIsHumid;
+    bool humidMode;
+    vector<double> phaseAngles;
+    vector<double> temperatures;
+    vector<double> pressures; // Pa
+    vector<double> o2;
+};
+
+// Sink of the benchmarked results, so the compiler cannot drop the calculations
+static volatile double sink;
+
+/**
+ * @brief Loads the golden dataset (CSV: calibIsHumid,humidMode,phaseAngle,temperature,pressurePa,o2 with a header line)
+ *
+ * @param path The path of the CSV file
+ * @param sets The loaded samples, one set per configuration
+ * @return True if the file has been read
+ */
+static bool loadGolden(const string& path, vector<GoldenSet>& sets)
+{
+    ifstream file(path);
+    if (!file) {
+        return false;
+    }
+
+    string line;
+    getline(file, line); // header
+    while (getline(file, line)) {
+        if (line.empty()) {
+            continue;
+        }
+
+        istringstream fields(line);
+        int calibIsHumid, humidMode;
+        double phaseAngle, temperature, pressure, o2;
+        char comma;
+        if (!(fields >> calibIsHumid >> comma >> humidMode >> comma >> phaseAngle >> comma >> temperature >> comma >> pressure >> comma >> o2)) {
+            cerr << "Ligne invalide : " << line << endl;
+            return false;
+        }
+
+        if (sets.empty() || sets.back().calibIsHumid != (calibIsHumid != 0) || sets.back().humidMode != (humidMode != 0)) {
+            GoldenSet set;
+            set.calibIsHumid = calibIsHumid != 0;
+            set.humidMode = humidMode != 0;
+            sets.push_back(set);
+        }
+        GoldenSet& set = sets.back();
+        set.phaseAngles.push_back(phaseAngle);
+        set.temperatures.push_back(temperature);
+        set.pressures.push_back(pressure);
+        set.o2.push_back(o2);
+    }
+    return true;
+}
+
+static void configure(MeasureConfig& config, const GoldenSet& set)
+{
+    config.set(237, 0.808, 30, -0.068, -0.00035, 0.000371, 0, 967, 60.22, 26.82, 20, 20, 100, set.calibIsHumid, false, set.humidMode);
+}
+
+static double relativeError(double value, double expected)
+{
+    return fabs(value - expected) / fabs(expected);
+}
+
+/**
+ * @brief Checks the scalar and the batch paths against the golden values
+ *
+ * @return The number of samples out of tolerance
+ */
+static size_t check(const MeasureConfig& config, const GoldenSet& set, const char* name, double tolerance)
+{
+    size_t count = set.o2.size();
+    size_t failures = 0;
+    double maxError = 0;
+
+    OxygenCalculation calc(&config);
+    vector<double> batch(count);
+    OxygenCalculation::computeBatch(config, set.phaseAngles.data(), set.temperatures.data(), set.pressures.data(), batch.data(), count);
+
+    for (size_t i = 0; i < count; i++) {
+        calc.setPhaseAngle(set.phaseAngles[i]);
+        calc.setTemperature(set.temperatures[i]);
+        calc.setPressure(set.pressures[i]);
+        double scalarError = relativeError(calc.getOxygenValue(), set.o2[i]);
+        double batchError = relativeError(batch[i], set.o2[i]);
+        double error = max(scalarError, batchError);
+        if (!(error <= tolerance)) {
+            if (failures < 10) {
+                cerr << name << " : phase " << set.phaseAngles[i] << ", temperature " << set.temperatures[i] << ", pression " << set.pressures[i]
+                     << " : attendu " << set.o2[i] << ", scalaire " << calc.getOxygenValue() << ", batch " << batch[i] << endl;
+            }
+            failures++;
+        }
+        if (error > maxError) {
+            maxError = error;
+        }
+    }
+
+    cout << name << " : " << count << " échantillons, erreur relative max " << maxError << (failures ? " ÉCHEC" : " OK") << endl;
+    return failures;
+}
+
+/**
+ * @brief Checks one FastMath kernel against the libm over an input range
+ *
+ * @param name The name of the kernel
+ * @param fast The approximation
+ * @param exact The libm function
+ * @param from The first input
+ * @param to The last input
+ * @param maxError The documented maximum error (relative, or absolute if relative is false)
+ * @param relative True to compare the relative errors
+ * @return True if the error stays below the documented maximum
+ */
+static bool checkKernel(const char* name, double (*fast)(double), double (*exact)(double), double from, double to, double maxError, bool relative)
+{
+    const int steps = 100000;
+    double worst = 0;
+    for (int i = 0; i <= steps; i++) {
+        double x = from + (to - from) * i / steps;
+        double expected = exact(x);
+        double error = fabs(fast(x) - expected);
+        if (relative) {
+            error /= fabs(expected);
+        }
+        if (error > worst) {
+            worst = error;
+        }
+    }
+
+    bool ok = worst <= maxError;
+    cout << "FastMath::" << name << " : erreur max " << worst << " (documentée " << maxError << ")" << (ok ? " OK" : " ÉCHEC") << endl;
+    return ok;
+}
+
+static double libmTan(double x) { return std::tan(x); }
+static double libmExp(double x) { return std::exp(x); }
+static double libmLog(double x) { return std::log(x); }
+
+/**
+ * @brief Checks the maximum errors documented in fastmath.h over the physical input range
+ * The phase angles go from 0 to 90° (the tangent is checked up to 89.9°, it diverges at 90°), the temperatures from 0 to 50 °C.
+ *
+ * @return The number of kernels out of their documented error
+ */
+static size_t checkFastMathKernels()
+{
+    size_t failures = 0;
+    failures += !checkKernel("tan", FastMath::tan, libmTan, 0, 89.9 * M_PI / 180.0, 1.4e-8, true);
+    // Argument of the exponential of pwT between 0 and 50 °C
+    failures += !checkKernel("exp", FastMath::exp, libmExp, 52.57 - 6690.9 / 273.15 - 4.681 * std::log(273.15), 52.57 - 6690.9 / 323.15 - 4.681 * std::log(323.15), 7.1e-9, true);
+    failures += !checkKernel("log", FastMath::log, libmLog, 273.15, 323.15, 7.1e-10, false);
+    return failures;
+}
+
+/**
+ * @brief Measures the time of one getOxygenValue call (the setters are included, as in the measure loop)
+ *
+ * @return The time per call in nanoseconds
+ */
+template <typename Calculation>
+static double benchScalar(const MeasureConfig& config, const GoldenSet& set)
+{
+    Calculation calc(&config);
+    size_t count = set.o2.size();
+    double sum = 0;
+
+    auto start = chrono::steady_clock::now();
+    for (int pass = 0; pass < BENCH_PASSES; pass++) {
+        for (size_t i = 0; i < count; i++) {
+            calc.setPhaseAngle(set.phaseAngles[i]);
+            calc.setTemperature(set.temperatures[i]);
+            calc.setPressure(set.pressures[i]);
+            sum += calc.getOxygenValue();
+        }
+    }
+    auto end = chrono::steady_clock::now();
+
+    sink = sum;
+    return chrono::duration<double, nano>(end - start).count() / ((double)BENCH_PASSES * count);
+}
+
+/**
+ * @brief Measures the time per sample of computeBatch over the whole set
+ *
+ * @return The time per sample in nanoseconds
+ */
+static double benchBatch(const MeasureConfig& config, const GoldenSet& set)
+{
+    size_t count = set.o2.size();
+    vector<double> o2(count);
+    double sum = 0;
+
+    auto start = chrono::steady_clock::now();
+    for (int pass = 0; pass < BENCH_PASSES; pass++) {
+        OxygenCalculation::computeBatch(config, set.phaseAngles.data(), set.temperatures.data(), set.pressures.data(), o2.data(), count);
+        sum += o2[pass % count];
+    }
+    auto end = chrono::steady_clock::now();
+
+    sink = sum;
+    return chrono::duration<double, nano>(end - start).count() / ((double)BENCH_PASSES * count);
+}
+
+#ifdef COUNT_LIBM_CALLS
+/**
+ * @brief Counts the libm calls (tan, exp, log, pow) made per sample by an implementation
+ *
+ * @return The mean number of calls per sample
+ */
+template <typename Calculation>
+static double countLibmCalls(const MeasureConfig& config, const GoldenSet& set)
+{
+    Calculation calc(&config);
+    size_t count = set.o2.size();
+    double sum = 0;
+
+    resetLibmCalls();
+    for (size_t i = 0; i < count; i++) {
+        calc.setPhaseAngle(set.phaseAngles[i]);
+        calc.setTemperature(set.temperatures[i]);
+        calc.setPressure(set.pressures[i]);
+        sum += calc.getOxygenValue();
+    }
+
+    sink = sum;
+    return (double)getLibmCalls() / count;
+}
+#endif
+
+/**
+ * @brief Counts the calls of the calibration-only helpers (ksv, B) made per sample by the original formulas
+ * The current implementation computes them once per configuration (MeasureConfig::set), so it makes none.
+ */
+static double countReferenceCalibrationCalls(const MeasureConfig& config, const GoldenSet& set)
+{
+    ReferenceOxygenCalculation calc(&config);
+    calc.setPhaseAngle(set.phaseAngles[0]);
+    calc.setTemperature(set.temperatures[0]);
+    calc.setPressure(set.pressures[0]);
+    sink = calc.getOxygenValue();
+    return (double)calc.calibrationCalls;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        cerr << "Utilisation : " << argv[0] << " <oxygen_golden.csv>" << endl;
+        return 2;
+    }
+
+    vector<GoldenSet> sets;
+    if (!loadGolden(argv[1], sets) || sets.empty()) {
+        cerr << "Impossible de lire le jeu de référence " << argv[1] << endl;
+        return 2;
+    }
+
+    size_t failures = checkFastMathKernels();
+    for (const GoldenSet& set : sets) {
+        MeasureConfig config;
+        configure(config, set);
+
+        string name = string(set.calibIsHumid ? "calibration humide" : "calibration sèche") + (set.humidMode ? ", mode humide" : ", mode sec");
+        failures += check(config, set, name.c_str(), GOLDEN_TOLERANCE);
+
+        double reference = benchScalar<ReferenceOxygenCalculation>(config, set);
+        double current = benchScalar<OxygenCalculation>(config, set);
+        cout << "  getOxygenValue : " << current << " ns/op (formules d'origine : " << reference << " ns/op, gain x" << reference / current << ")" << endl;
+        cout << "  computeBatch : " << benchBatch(config, set) << " ns/échantillon" << endl;
+        cout << "  appels ksv/B par échantillon : " << countReferenceCalibrationCalls(config, set) << " -> 0" << endl;
+#ifdef COUNT_LIBM_CALLS
+        cout << "  appels libm (tan/exp/log/pow) par échantillon : " << countLibmCalls<ReferenceOxygenCalculation>(config, set)
+             << " -> " << countLibmCalls<OxygenCalculation>(config, set) << endl;
+#endif
+
+        MeasureConfig fastConfig = config;
+        fastConfig.fastMath = true;
+        failures += check(fastConfig, set, (name + ", fast-math").c_str(), FAST_MATH_TOLERANCE);
+        double fast = benchScalar<OxygenCalculation>(fastConfig, set);
+        cout << "  getOxygenValue (fast-math) : " << fast << " ns/op (gain x" << current / fast << " sur le calcul exact)" << endl;
+        double fastBatch = benchBatch(fastConfig, set);
+        cout << "  computeBatch (fast-math) : " << fastBatch << " ns/échantillon (gain x" << fast / fastBatch << " sur getOxygenValue)" << endl;
+#ifdef COUNT_LIBM_CALLS
+        cout << "  appels libm (tan/exp/log/pow) par échantillon : " << countLibmCalls<OxygenCalculation>(fastConfig, set) << endl;
+#endif
+    }
+
+    if (failures) {
+        cerr << failures << " valeur(s) hors tolérance" << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,286 @@
+#include <iostream>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include "../sensormeasure.h"
+#include "../TcpMessages/TcpAnswer.h"
+#include "../TcpMessages/BinaryFrame.h"
+
+using namespace std;
+
+// Number of encodings and decodings measured per format
+#define BENCH_ITERATIONS 200000
+
+// Maximum number of Fibox probes read by the decoders
+#define MAX_PROBES 8
+
+/**
+ * @brief A measure as a client reads it (NAN if not available)
+ */
+struct DecodedMeasure {
+    double values[SensorMeasure::CHANNEL_COUNT];
+    size_t probeCount;
+    char probeSerials[MAX_PROBES][64];
+    double probeValues[MAX_PROBES];
+};
+
+// Sink of the benchmarked results, so the compiler cannot drop the encodings and decodings
+static volatile double sink;
+
+static void clear(DecodedMeasure& decoded)
+{
+    for (double& value : decoded.values) {
+        value = NAN;
+    }
+    decoded.probeCount = 0;
+}
+
+/**
+ * @brief Decodes a GET_MEASURE answer of the text protocol, as a client does: the numbers of the "data" object
+ * are read with strtod, the keys of the O2Probes object are the serial numbers of the probes.
+ *
+ * @return False if the answer is not a measure
+ */
+static bool decodeText(const String& answer, DecodedMeasure& decoded)
+{
+    clear(decoded);
+    const char* data = strstr(answer.c_str(), "\"data\":");
+    if (data == nullptr) {
+        return false;
+    }
+
+    bool inProbes = false;
+    const char* cursor = data + 7;
+    while (*cursor != '\0') {
+        if (*cursor == '}' && inProbes) {
+            inProbes = false;
+        }
+        if (*cursor != '"') {
+            cursor++;
+            continue;
+        }
+
+        // "key": value
+        const char* key = cursor + 1;
+        const char* keyEnd = strchr(key, '"');
+        if (keyEnd == nullptr) {
+            return false;
+        }
+        cursor = keyEnd + 1;
+        while (*cursor == ':' || *cursor == ' ') {
+            cursor++;
+        }
+
+        string_view name(key, keyEnd - key);
+        if (*cursor == '{') {
+            inProbes = name == "O2Probes";
+            cursor++;
+            continue;
+        }
+
+        double value = strncmp(cursor, "null", 4) == 0 ? NAN : strtod(cursor, nullptr);
+        if (inProbes) {
+            if (decoded.probeCount == MAX_PROBES || name.size() >= sizeof(decoded.probeSerials[0])) {
+                return false;
+            }
+            memcpy(decoded.probeSerials[decoded.probeCount], name.data(), name.size());
+            decoded.probeSerials[decoded.probeCount][name.size()] = '\0';
+            decoded.probeValues[decoded.probeCount++] = value;
+        }
+        else {
+            int channel = TcpAnswer::getMeasurementChannel(name);
+            if (channel < 0) {
+                return false;
+            }
+            decoded.values[channel] = value;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Reads a little-endian value of a binary frame
+ */
+template <typename T>
+static T readValue(const Byte* bytes)
+{
+    uint64_t raw = 0;
+    for (size_t i = 0; i < sizeof(T); i++) {
+        raw |= (uint64_t)bytes[i] << (8 * i);
+    }
+    T value;
+    memcpy(&value, &raw, sizeof(T));
+    return value;
+}
+
+/**
+ * @brief Decodes a MEASURE frame of the binary protocol (layout documented in BinaryFrame.h)
+ *
+ * @return False if the frame is not a valid MEASURE frame
+ */
+static bool decodeBinary(const String& frame, DecodedMeasure& decoded)
+{
+    clear(decoded);
+    const Byte* bytes = (const Byte*)frame.data();
+    const Byte* end = bytes + frame.size();
+    if (frame.size() <= BINARY_FRAME_MEASURE_ID_OFFSET || bytes[0] != BINARY_FRAME_MAGIC_0 || bytes[1] != BINARY_FRAME_MAGIC_1 || bytes[3] != BinaryFrame::MEASURE
+        || readValue<uint32_t>(bytes + 4) != frame.size() - BINARY_FRAME_HEADER_SIZE) {
+        return false;
+    }
+
+    const Byte* cursor = bytes + BINARY_FRAME_HEADER_SIZE;
+    size_t valueSize = *cursor++;
+    cursor += sizeof(int64_t); // timestamp
+    cursor += 1 + *cursor;     // request id
+    if (cursor + 2 > end || (valueSize != sizeof(float) && valueSize != sizeof(double))) {
+        return false;
+    }
+    Byte channelMask = *cursor++;
+    Byte validMask = *cursor++;
+
+    for (UInt channel = 0; channel < SensorMeasure::CHANNEL_COUNT; channel++) {
+        if (!(channelMask & (1U << channel))) {
+            continue;
+        }
+
+        size_t count = 1;
+        if (channel == SensorMeasure::O2_PROBES) {
+            count = *cursor++;
+            if (count > MAX_PROBES) {
+                return false;
+            }
+        }
+        for (size_t i = 0; i < count; i++) {
+            if (channel == SensorMeasure::O2_PROBES) {
+                size_t serialSize = *cursor++;
+                if (cursor + serialSize > end || serialSize >= sizeof(decoded.probeSerials[0])) {
+                    return false;
+                }
+                memcpy(decoded.probeSerials[i], cursor, serialSize);
+                decoded.probeSerials[i][serialSize] = '\0';
+                cursor += serialSize;
+            }
+            if (cursor + valueSize > end) {
+                return false;
+            }
+            double value = valueSize == sizeof(float) ? readValue<float>(cursor) : readValue<double>(cursor);
+            cursor += valueSize;
+            if (channel == SensorMeasure::O2_PROBES) {
+                decoded.probeValues[decoded.probeCount++] = value;
+            }
+            else {
+                decoded.values[channel] = (validMask & (1U << channel)) ? value : NAN;
+            }
+        }
+    }
+    return cursor == end;
+}
+
+/**
+ * @brief Checks that a decoded measure gives the values of the measure
+ *
+ * @param tolerance The maximum relative difference (the text protocol writes 6 decimals)
+ */
+static bool matches(SensorMeasure& measure, const DecodedMeasure& decoded, double tolerance)
+{
+    for (UInt channel = 0; channel < SensorMeasure::CHANNEL_COUNT; channel++) {
+        if (channel == SensorMeasure::O2_PROBES) {
+            continue;
+        }
+        double expected = measure.getValue((SensorMeasure::Channel)channel);
+        if (!(fabs(decoded.values[channel] - expected) <= tolerance * max(1.0, fabs(expected)))) {
+            return false;
+        }
+    }
+
+    const map<String, float>& probes = measure.getO2ProbesValues();
+    if (decoded.probeCount != probes.size()) {
+        return false;
+    }
+    size_t index = 0;
+    for (const auto& probe : probes) {
+        if (probe.first != decoded.probeSerials[index] || !(fabs(decoded.probeValues[index] - probe.second) <= tolerance * max(1.0, fabs((double)probe.second)))) {
+            return false;
+        }
+        index++;
+    }
+    return true;
+}
+
+static void encodeText(SensorMeasure* measure, TcpAnswer& answer, String& out)
+{
+    answer.reset("1");
+    answer.setMeasurementsData(measure);
+    answer.write(out);
+    out += '\n';
+}
+
+/**
+ * @brief Measures one format: checks its round trip, then prints its size and its encoding and decoding times
+ *
+ * @param name The name of the format
+ * @param precision The precision of the binary protocol (-1 for the text protocol, 0 for float32, 1 for float64)
+ * @return True if the decoded measure gives the values of the measure
+ */
+static bool bench(SensorMeasure& measure, const char* name, int precision, size_t valueCount)
+{
+    TcpAnswer answer;
+    String encoded;
+    DecodedMeasure decoded;
+    UInt channelMask = TcpAnswer::getMeasurementChannelMask(vector<String>());
+
+    auto encode = [&]() {
+        if (precision < 0) {
+            encodeText(&measure, answer, encoded);
+        }
+        else {
+            BinaryFrame::encodeMeasure(encoded, "1", &measure, channelMask, precision == 1);
+        }
+    };
+    auto decode = [&]() {
+        return precision < 0 ? decodeText(encoded, decoded) : decodeBinary(encoded, decoded);
+    };
+
+    encode();
+    bool ok = decode() && matches(measure, decoded, precision < 0 ? 1e-6 : 0);
+
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        encode();
+    }
+    auto middle = chrono::steady_clock::now();
+    double sum = 0;
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        decode();
+        sum += decoded.values[SensorMeasure::TEMPERATURE];
+    }
+    auto end = chrono::steady_clock::now();
+    sink = sum;
+
+    double encodeNs = chrono::duration<double, nano>(middle - start).count() / BENCH_ITERATIONS;
+    double decodeNs = chrono::duration<double, nano>(end - middle).count() / BENCH_ITERATIONS;
+    cout << name << " : " << encoded.size() << " octets par mesure (" << (double)encoded.size() / valueCount << " par valeur), encodage "
+         << encodeNs << " ns, décodage " << decodeNs << " ns" << (ok ? " OK" : " ÉCHEC (valeurs décodées différentes)") << endl;
+    return ok;
+}
+
+int main()
+{
+    // A full snapshot: the 6 sensor values and 2 Fibox probes
+    SensorMeasure measure(21.53f, 45.27f, 1013.25f, 412.6f, 20.94f, 350.0f);
+    measure.setO2Probes({ { "FB-000123", 20.91f }, { "FB-000456", 20.97f } });
+    size_t valueCount = SensorMeasure::CHANNEL_COUNT - 1 + measure.getO2ProbesValues().size();
+
+    size_t failures = 0;
+    failures += !bench(measure, "Texte (JSON)", -1, valueCount);
+    failures += !bench(measure, "Binaire float32", 0, valueCount);
+    failures += !bench(measure, "Binaire float64", 1, valueCount);
+
+    if (failures) {
+        cerr << failures << " format(s) ne restituent pas la mesure" << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,44 @@
+#ifndef REFERENCEOXYGENCALCULATION_H
+#define REFERENCEOXYGENCALCULATION_H
+
+#include <cstddef>
+#include "../MeasureConfig.h"
+
+/**
+ * ReferenceOxygenCalculation - The original oxygen calculation, recomputing the calibration-only terms for each sample
+ * It is the reference of the latency and call count comparison (the golden dataset has been generated with these formulas).
+ * It is compiled in its own translation unit, like OxygenCalculation, so the compiler cannot hoist its calls out of the benchmark loop.
+ */
+class ReferenceOxygenCalculation
+{
+private:
+    const MeasureConfig* config;
+    double mPressure;
+    double mTemperature;
+    double mPhaseAngle;
+
+    double convertOxygenValue(double val);
+    double tanPhi(double angle);
+    double tanPhi0(double temp);
+    double B();
+    double ksv();
+    double ksvt();
+    double a();
+    double b();
+    double c();
+    double pwT(double temperature);
+    double basicOxyCalculation();
+
+public:
+    // Number of calls of the calibration-only helpers (ksv and B)
+    size_t calibrationCalls;
+
+    ReferenceOxygenCalculation(const MeasureConfig* config);
+
+    void setPressure(double valInPa);
+    void setTemperature(double valInC);
+    void setPhaseAngle(double valInDegres);
+    double getOxygenValue();
+};
+
+#endif // REFERENCEOXYGENCALCULATION_H
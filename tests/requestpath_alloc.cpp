@@ -0,0 +1,157 @@
+#include <iostream>
+#include <thread>
+#include <cstring>
+#include <cstdint>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "../commands.h"
+#include "../eventloop.h"
+#include "../tcpserver.h"
+#include "../measuremodule.h"
+#include "../measurecache.h"
+#include "../TcpMessages/BinaryFrame.h"
+#include "allocations.h"
+
+using namespace std;
+
+// Number of requests handled before counting (the reused buffers reach their size, the measure is cached)
+#define WARMUP_REQUESTS 20
+
+// Number of requests counted per command
+#define COUNTED_REQUESTS 1000
+
+/**
+ * @brief Reads exactly size bytes from the client socket
+ *
+ * @return False if the connection has been closed
+ */
+static bool readFully(int fd, char* buffer, size_t size)
+{
+    size_t done = 0;
+    while (done < size) {
+        ssize_t count = read(fd, buffer + done, size - done);
+        if (count <= 0) {
+            return false;
+        }
+        done += count;
+    }
+    return true;
+}
+
+/**
+ * @brief Sends a request and reads its answer (a text line, or a binary frame)
+ * The client side does not allocate, so only the allocations of the daemon are counted.
+ *
+ * @param fd The client socket
+ * @param request The request, with its delimiter
+ * @param binary True if the answer is a binary frame
+ * @param answer The answer (at most size bytes)
+ * @return The size of the answer, 0 if the connection has been closed or if the answer is too long
+ */
+static size_t roundTrip(int fd, const char* request, bool binary, char* answer, size_t size)
+{
+    size_t length = strlen(request);
+    if (write(fd, request, length) != (ssize_t)length) {
+        return 0;
+    }
+
+    if (binary) {
+        if (!readFully(fd, answer, BINARY_FRAME_HEADER_SIZE)) {
+            return 0;
+        }
+        uint32_t payload;
+        memcpy(&payload, answer + 4, sizeof(payload));
+        if (BINARY_FRAME_HEADER_SIZE + payload > size || !readFully(fd, answer + BINARY_FRAME_HEADER_SIZE, payload)) {
+            return 0;
+        }
+        return BINARY_FRAME_HEADER_SIZE + payload;
+    }
+
+    size_t done = 0;
+    while (done < size) {
+        if (!readFully(fd, answer + done, 1)) {
+            return 0;
+        }
+        if (answer[done++] == '\n') {
+            return done;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Counts the heap allocations made while handling the same request COUNTED_REQUESTS times, after a warm-up
+ *
+ * @return The number of allocations, SIZE_MAX if the request has not been answered
+ */
+static size_t countAllocations(int fd, const char* name, const char* request, bool binary, const char* expected)
+{
+    char answer[8192];
+    for (int i = 0; i < WARMUP_REQUESTS; i++) {
+        size_t length = roundTrip(fd, request, binary, answer, sizeof(answer));
+        if (length == 0 || memmem(answer, length, expected, strlen(expected)) == nullptr) {
+            cerr << name << " : réponse inattendue" << endl;
+            return SIZE_MAX;
+        }
+    }
+
+    startCountingAllocations();
+    for (int i = 0; i < COUNTED_REQUESTS; i++) {
+        if (roundTrip(fd, request, binary, answer, sizeof(answer)) == 0) {
+            stopCountingAllocations();
+            cerr << name << " : pas de réponse" << endl;
+            return SIZE_MAX;
+        }
+    }
+
+    size_t count = stopCountingAllocations();
+    cout << name << " : " << count << " allocation(s) pour " << COUNTED_REQUESTS << " requêtes" << (count ? " ÉCHEC" : " OK") << endl;
+    return count;
+}
+
+int main()
+{
+    EventLoop* loop = new EventLoop();
+    TcpServer* server = new TcpServer(loop, handleRequest);
+    tcpServer = server;
+    mm = new MeasureModule(loop);
+    measureCache = new MeasureCache(mm);
+
+    String path = "/tmp/requestpath_alloc." + to_string(getpid()) + ".sock";
+    if (!server->listenUnix(path, [](const struct ucred&) { return true; })) {
+        return 2;
+    }
+    thread(&EventLoop::run, loop).detach();
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    struct sockaddr_un address {};
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path.c_str());
+    if (connect(fd, (struct sockaddr*)&address, sizeof(address)) < 0) {
+        perror("connect");
+        unlink(path.c_str());
+        return 2;
+    }
+    unlink(path.c_str());
+
+    size_t failures = 0;
+    failures += countAllocations(fd, "GET_MEASURE (texte)", "1 GET_MEASURE\n", false, "\"temperature\"") != 0;
+    failures += countAllocations(fd, "GET_STATS (texte)", "2 GET_STATS temperature 10s\n", false, "\"2\"") != 0;
+    failures += countAllocations(fd, "Commande inconnue (texte)", "3 UNKNOWN\n", false, "Commande inconnue.") != 0;
+
+    char answer[256];
+    if (roundTrip(fd, "4 SET_PROTOCOL BINARY FLOAT32\n", false, answer, sizeof(answer)) == 0) {
+        cerr << "SET_PROTOCOL : pas de réponse" << endl;
+        return 1;
+    }
+    failures += countAllocations(fd, "GET_MEASURE (binaire)", "5 GET_MEASURE\n", true, "FB") != 0;
+    failures += countAllocations(fd, "GET_STATS (binaire)", "6 GET_STATS temperature 10s\n", true, "\"6\"") != 0;
+
+    close(fd);
+    if (failures) {
+        cerr << failures << " commande(s) allouent de la mémoire en régime établi" << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,140 @@
+#include "windowstats.h"
+#include <chrono>
+#include <cmath>
+
+/**
+ * The windows of the statistics: name and length in seconds
+ */
+static const struct {
+    const char* name;
+    int64_t seconds;
+} WINDOW_STATS_WINDOWS[WINDOW_STATS_WINDOW_COUNT] = {
+    { "10s", 10 },
+    { "1m", 60 },
+    { "10m", 600 },
+    { "1h", 3600 }
+};
+
+WindowStats::WindowStats()
+{
+    for (int window = 0; window < WINDOW_STATS_WINDOW_COUNT; window++) {
+        windows[window].length = WINDOW_STATS_WINDOWS[window].seconds * 1000;
+        windows[window].clear();
+    }
+    lastTimestamp = 0;
+    nextSequence = 0;
+}
+
+void WindowStats::add(double value)
+{
+    lock_guard<mutex> lock(statsMutex);
+    Sample sample{ nextSequence++, now(), value };
+    for (Window& window : windows) {
+        window.expire(sample.time);
+        window.add(sample);
+    }
+    lastTimestamp = time(nullptr);
+}
+
+void WindowStats::clear()
+{
+    lock_guard<mutex> lock(statsMutex);
+    for (Window& window : windows) {
+        window.clear();
+    }
+    lastTimestamp = 0;
+}
+
+WindowStats::Result WindowStats::get(int window)
+{
+    lock_guard<mutex> lock(statsMutex);
+    Window& stats = windows[window];
+    stats.expire(now());
+
+    Result result{ stats.samples.size(), 0, 0, 0, 0, lastTimestamp };
+    if (result.count > 0) {
+        result.min = stats.minimums.front().value;
+        result.max = stats.maximums.front().value;
+        result.mean = stats.mean;
+        result.stddev = result.count > 1 ? sqrt(stats.m2 / (result.count - 1)) : 0;
+    }
+    return result;
+}
+
+int WindowStats::getWindow(string_view name)
+{
+    for (int window = 0; window < WINDOW_STATS_WINDOW_COUNT; window++) {
+        if (name == WINDOW_STATS_WINDOWS[window].name) {
+            return window;
+        }
+    }
+    return -1;
+}
+
+const char* WindowStats::getWindowName(int window)
+{
+    return WINDOW_STATS_WINDOWS[window].name;
+}
+
+int64_t WindowStats::now()
+{
+    return chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void WindowStats::Window::add(const Sample& sample)
+{
+    samples.push_back(sample);
+
+    // Welford
+    double delta = sample.value - mean;
+    mean += delta / samples.size();
+    m2 += delta * (sample.value - mean);
+
+    // The samples that can no longer be the minimum (or maximum) of the window are dropped
+    while (!minimums.empty() && minimums.back().value >= sample.value) {
+        minimums.pop_back();
+    }
+    minimums.push_back(sample);
+    while (!maximums.empty() && maximums.back().value <= sample.value) {
+        maximums.pop_back();
+    }
+    maximums.push_back(sample);
+}
+
+void WindowStats::Window::expire(int64_t now)
+{
+    while (!samples.empty() && now - samples.front().time >= length) {
+        Sample sample = samples.front();
+        samples.pop_front();
+
+        // Welford, in reverse
+        if (samples.empty()) {
+            mean = 0;
+            m2 = 0;
+        } else {
+            double delta = sample.value - mean;
+            mean -= delta / samples.size();
+            m2 -= delta * (sample.value - mean);
+            if (m2 < 0) {
+                m2 = 0; // rounding errors
+            }
+        }
+
+        // The oldest sample is the first of a monotonic deque if it is still in it
+        if (!minimums.empty() && minimums.front().sequence == sample.sequence) {
+            minimums.pop_front();
+        }
+        if (!maximums.empty() && maximums.front().sequence == sample.sequence) {
+            maximums.pop_front();
+        }
+    }
+}
+
+void WindowStats::Window::clear()
+{
+    samples.clear();
+    minimums.clear();
+    maximums.clear();
+    mean = 0;
+    m2 = 0;
+}
@@ -0,0 +1,120 @@
+#ifndef WINDOWSTATS_H
+#define WINDOWSTATS_H
+
+#include <deque>
+#include <mutex>
+#include <ctime>
+#include <cstdint>
+#include <string_view>
+#include "types.h"
+using namespace std;
+
+// Number of sliding windows of the statistics (see WINDOW_STATS_WINDOWS in windowstats.cpp)
+#define WINDOW_STATS_WINDOW_COUNT 4
+
+/**
+ * @brief The WindowStats class keeps the statistics of a measure over sliding time windows (10s, 1m, 10m and 1h).
+ * Each sample updates the statistics of every window incrementally: count, mean and variance (Welford, the samples
+ * leaving the window are removed the same way), minimum and maximum (monotonic deques). Reading the statistics of a
+ * window therefore takes a constant time (amortized) whatever its length.
+ * It is thread-safe: the samples are added by the measure clocks and the statistics read by the TCP commands.
+ */
+class WindowStats
+{
+public:
+    /**
+     * @brief The statistics of a window.
+     */
+    struct Result
+    {
+        size_t count;
+        double min;
+        double max;
+        double mean;
+        double stddev;        // sample standard deviation (0 with less than 2 samples)
+        time_t lastTimestamp; // date of the last sample (0 if no sample has been added)
+    };
+
+    WindowStats();
+
+    /**
+     * @brief Adds a sample (dated now).
+     *
+     * @param value The value of the sample.
+     */
+    void add(double value);
+
+    /**
+     * @brief Removes all the samples.
+     */
+    void clear();
+
+    /**
+     * @brief Gets the statistics of a window.
+     *
+     * @param window The index of the window (see getWindow).
+     * @return The statistics (count 0 if the window has no sample).
+     */
+    Result get(int window);
+
+    /**
+     * @brief Gets the index of a window from its name.
+     *
+     * @param name The name of the window (10s, 1m, 10m or 1h).
+     * @return The index of the window, -1 if it does not exist.
+     */
+    static int getWindow(string_view name);
+
+    /**
+     * @brief Gets the name of a window.
+     *
+     * @param window The index of the window.
+     * @return The name of the window.
+     */
+    static const char* getWindowName(int window);
+
+private:
+    struct Sample
+    {
+        uint64_t sequence;
+        int64_t time; // steady clock (milliseconds)
+        double value;
+    };
+
+    /**
+     * @brief The samples and the running statistics of a window.
+     */
+    struct Window
+    {
+        int64_t length; // milliseconds
+        deque<Sample> samples;
+        deque<Sample> minimums; // increasing values: the front is the minimum of the window
+        deque<Sample> maximums; // decreasing values: the front is the maximum of the window
+        double mean;
+        double m2; // sum of the squared differences to the mean
+
+        void add(const Sample& sample);
+        void expire(int64_t now);
+        void clear();
+    };
+
+    /**
+     * @brief Gets the current time of the steady clock in milliseconds.
+     */
+    static int64_t now();
+
+    Window windows[WINDOW_STATS_WINDOW_COUNT];
+    time_t lastTimestamp;
+
+    /**
+     * @brief The sequence number of the next sample (identifies a sample in the monotonic deques).
+     */
+    uint64_t nextSequence;
+
+    /**
+     * @brief The mutex protecting the windows.
+     */
+    mutex statsMutex;
+};
+
+#endif // WINDOWSTATS_H